@@ -2,16 +2,29 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <signal.h>
 
 #include "global.h"
+#include "alloc.h"
 #include "constants.h"
 #include "bm_search.h"
+#include "build.h"		/* for linecontrol */
 #include "library.h"
 #include "os_wrapper.h"
+#include "pool.h"
 
 #define ALPHABET_LEN 256
 #define NOT_FOUND patlen
 #define max(a, b) ((a < b) ? b : a)
+#define LINES_LOOKUP_MIN 4096 // text to count lines in before using the line table
+#define OUTPUT_WINDOW 256 // files searched ahead of the one being output
+#define OUTPUT_BUFFER_INC 65536 // output buffer size increment
+#define OUTPUT_BUFFER_LINE 64 // room for the output of a match but its file name
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BM_SEARCH_SIMD 1
+#include <immintrin.h>
+#endif
 
 // delta1 table: delta1[c] contains the distance between the last
 // character of pat and the rightmost occurrence of c in pat.
@@ -115,27 +128,32 @@ static struct {
 	/* parameters for output.*/
 	FILE* output;
 	char* format;
-	/* search file count */
-	int file_count;
 	/* search pattern */
 	char* pat;
+	int fold; /* the pattern is a lower case copy, to find in either case */
 	int* delta1;
 	int* delta2;
-	worker_info_t* workers;
-	/* mutex for print*/
-	pthread_mutex_t output_lock;
-
-	/* mutex for global worker. */
-	pthread_mutex_t global_worker_lock;
-	/* cond for global worker. */
-	pthread_cond_t global_worker_cond;
-	/* global worker for all threads. */
-	worker_info_t global_worker;
-	/* flag for checking if all files have been added into global worker */
-	int finish_of_adding_files;
 
 } bm_search_data;
 
+/* a file being searched ahead of the output */
+typedef struct {
+	POOLGROUP group;
+	char* file;
+	output_buffer_t output;
+	bm_search_file_fn search;
+	int status;
+} output_slot_t;
+
+/* an interrupt during a search on the pool, held until it is over */
+static volatile sig_atomic_t bm_search_interrupted;
+
+static RETSIGTYPE bm_search_interrupt( int sig )
+{
+	signal( sig, bm_search_interrupt );
+	bm_search_interrupted = 1;
+}
+
 
 typedef struct {
 	int* delta1;
@@ -145,6 +163,12 @@ typedef struct {
 	uint8_t* pat;
 	uint32_t pat_len;
 	int line_number;
+	uint8_t* line_counted; /* the lines before this have been counted */
+	uint8_t* buffer; /* the start of the file, or of the block of it read */
+	size_t base; /* the file offset of the buffer */
+	char* lines_file; /* the file to find in the line table at a match */
+	LTFILE* lines; /* its lines in the table, if they are there */
+	int fold; /* find the pattern, which is in lower case, in either case */
 } bm_search_state_t;
 
 static void bm_search_init( bm_search_state_t* state, 
@@ -162,6 +186,19 @@ static void bm_search_init( bm_search_state_t* state,
 	state->pat_len = patlen;
 
 	state->line_number = 1;
+	state->line_counted = string;
+	state->buffer = string;
+	state->base = 0;
+	state->lines_file = NULL;
+	state->lines = NULL;
+	state->fold = 0;
+}
+
+/* number the lines of the matches from the line table, when the file is in
+   it, instead of counting them */
+static void bm_search_use_lines( bm_search_state_t* state, char* file )
+{
+	state->lines_file = file;
 }
 
 static void bm_search_deinit( bm_search_state_t* state )
@@ -183,6 +220,12 @@ bm_search_set( bm_search_state_t* state, int* delta1, int* delta2,
 	state->pat_len = patlen;
 
 	state->line_number = 1;
+	state->line_counted = string;
+	state->buffer = string;
+	state->base = 0;
+	state->lines_file = NULL;
+	state->lines = NULL;
+	state->fold = 0;
 }
 
 static uint8_t* boyer_moore( bm_search_state_t* state ) {
@@ -201,12 +244,7 @@ static uint8_t* boyer_moore( bm_search_state_t* state ) {
     }
 
     i = patlen-1;
-	step = i;
     while (i < stringlen) {
-		int k = 0;
-		for ( ; k < step; ++k ) {
-			if (string[i - k ] == '\n') ++state->line_number;
-		}
         int j = patlen-1;
         while (j >= 0 && (string[i] == pat[j])) {
             --i;
@@ -222,669 +260,1383 @@ static uint8_t* boyer_moore( bm_search_state_t* state ) {
     return NULL;
 }
 
-static int get_line_number( uint8_t* buffer, int buffer_offset )
+/* find the pattern from the end of the text that the vector kernels could
+   not load whole */
+static uint8_t* simd_search_tail( bm_search_state_t* state, uint32_t i )
 {
-	int line = 1;
-	int i = 0;
-	while ( i < buffer_offset ) {
-		if ( buffer[i] == '\n' ) ++line;
-		++i;
+	uint8_t* string = state->text;
+	uint8_t* pat = state->pat;
+	uint32_t patlen = state->pat_len;
+	uint8_t* p;
+
+	while ( i + patlen <= state->text_len ) {
+		p = memchr( string + i, pat[0], state->text_len - patlen + 1 - i );
+		if ( p == NULL ) break;
+		if ( memcmp( p + 1, pat + 1, patlen - 1 ) == 0 ) return p;
+		i = p - string + 1;
 	}
-	return line;
+	return NULL;
 }
 
-static int is_printable_char( uint8_t c )
-{
-	return c >= 20 && c <= 126;
-}
+#ifdef BM_SEARCH_SIMD
+/* The vector kernels compare a block of positions at once with the first
+   and with the last byte of the pattern, and only compare the rest of the
+   pattern where both match, which in source text is rare. */
 
-static int is_line_ending_char( char c )
+__attribute__((target("sse2")))
+static uint8_t* simd_search_sse2( bm_search_state_t* state )
 {
-	return c == '\n' || c == '\r';
+	uint8_t* string = state->text;
+	uint8_t* pat = state->pat;
+	uint32_t patlen = state->pat_len;
+	uint32_t i;
+	__m128i first, last, block_first, block_last;
+	unsigned mask;
+
+	if ( patlen < 2 ) return simd_search_tail( state, 0 );
+	first = _mm_set1_epi8( pat[0] );
+	last  = _mm_set1_epi8( pat[patlen - 1] );
+	for ( i = 0; i + patlen - 1 + 16 <= state->text_len; i += 16 ) {
+		block_first = _mm_loadu_si128( (const __m128i*)( string + i ) );
+		block_last  = _mm_loadu_si128( (const __m128i*)( string + i + patlen - 1 ) );
+		mask = _mm_movemask_epi8( _mm_and_si128(
+				_mm_cmpeq_epi8( first, block_first ),
+				_mm_cmpeq_epi8( last, block_last ) ) );
+		while ( mask != 0 ) {
+			int bit = __builtin_ctz( mask );
+			if ( memcmp( string + i + bit + 1, pat + 1, patlen - 2 ) == 0 ) {
+				return string + i + bit;
+			}
+			mask &= mask - 1;
+		}
+	}
+	return simd_search_tail( state, i );
 }
 
-int bm_search(char *file, FILE *output, char *format, char* pat)
+__attribute__((target("avx2")))
+static uint8_t* simd_search_avx2( bm_search_state_t* state )
 {
-	FILE* fptr;
-	int line_number = 1;
-
-	fptr = fopen(file, "rb");
-    if (fptr == NULL) return(-1);
-	fseek( fptr, 0, SEEK_END );
-	size_t size = ftell( fptr );
-	uint8_t* buffer = (uint8_t*)mymalloc( size );
-	if ( buffer != NULL ) {
-		fseek( fptr, 0, SEEK_SET );
-		int rv = fread( buffer, 1, size, fptr );
-		if ( rv == size ) {
-			int pat_len = (int)strlen( pat );
-			int buffer_offset = 0;
-
-
-			bm_search_state_t state;
-			bm_search_init( &state, buffer, size, (uint8_t*)pat, pat_len );
-			uint8_t* target = boyer_moore( &state );
-			while ( target != NULL ) {
-				line_number = state.line_number;
-				fprintf( output, format, file, line_number );
-				const char* p = (const char*)target;
-				while ( *p != '\n' && (uint8_t*)p >= buffer ) {
-					--p;
-				}
-				++p;
-				while ( *p != '\n' && ((uint8_t*)p - buffer) < size  ) {
-					if ( is_printable_char( *p ) ) {
-						putc( *p, output );
-					}
-					++p;
-				}
-				putc( '\n', output );
-				buffer_offset = (target - buffer ) + pat_len;
-				target = NULL;
-				if ( buffer_offset < size ) {
-					state.text = buffer + buffer_offset;
-					state.text_len = size - buffer_offset;
-					target = boyer_moore( &state );
-				}
+	uint8_t* string = state->text;
+	uint8_t* pat = state->pat;
+	uint32_t patlen = state->pat_len;
+	uint32_t i;
+	__m256i first, last, block_first, block_last;
+	unsigned mask;
+
+	if ( patlen < 2 ) return simd_search_tail( state, 0 );
+	first = _mm256_set1_epi8( pat[0] );
+	last  = _mm256_set1_epi8( pat[patlen - 1] );
+	for ( i = 0; i + patlen - 1 + 32 <= state->text_len; i += 32 ) {
+		block_first = _mm256_loadu_si256( (const __m256i*)( string + i ) );
+		block_last  = _mm256_loadu_si256( (const __m256i*)( string + i + patlen - 1 ) );
+		mask = (unsigned)_mm256_movemask_epi8( _mm256_and_si256(
+				_mm256_cmpeq_epi8( first, block_first ),
+				_mm256_cmpeq_epi8( last, block_last ) ) );
+		while ( mask != 0 ) {
+			int bit = __builtin_ctz( mask );
+			if ( memcmp( string + i + bit + 1, pat + 1, patlen - 2 ) == 0 ) {
+				return string + i + bit;
 			}
-			bm_search_deinit( &state );
+			mask &= mask - 1;
 		}
-
-		free( buffer );
 	}
+	return simd_search_tail( state, i );
+}
+#endif
+
+/* The caseless kernels find a pattern that is in lower case in a text in
+   either case.  They fold the bytes as tolower() does in the C locale, the
+   vector ones a block at a time by adding 0x20 to the bytes from A to Z, so
+   they cost about the same as the kernels above. */
+
+#define FOLD(c) ( (uint8_t)( (c) - 'A' ) < 26 ? (c) + ( 'a' - 'A' ) : (c) )
+#define UNFOLD(c) ( (uint8_t)( (c) - 'a' ) < 26 ? (c) - ( 'a' - 'A' ) : (c) )
+
+/* compare a text, folded, with a part of the pattern */
+static int fold_compare( const uint8_t* text, const uint8_t* pat, uint32_t len )
+{
+	uint32_t i;
 
-	fclose(fptr);
+	for ( i = 0; i < len; ++i ) {
+		if ( FOLD( text[i] ) != pat[i] ) return 1;
+	}
 	return 0;
 }
 
+/* find the pattern in either case from a position in the text */
+static uint8_t* fold_search_tail( bm_search_state_t* state, uint32_t i )
+{
+	uint8_t* string = state->text;
+	uint8_t* pat = state->pat;
+	uint32_t patlen = state->pat_len;
+
+	for ( ; i + patlen <= state->text_len; ++i ) {
+		if ( FOLD( string[i] ) == pat[0] && 
+				fold_compare( string + i + 1, pat + 1, patlen - 1 ) == 0 ) {
+			return string + i;
+		}
+	}
+	return NULL;
+}
+
+static uint8_t* fold_search_scalar( bm_search_state_t* state )
+{
+	return fold_search_tail( state, 0 );
+}
 
-static void bm_search_set_match( match_info_t* match,
-		char* filename, int line_number, size_t offset )
+#ifdef BM_SEARCH_SIMD
+__attribute__((target("sse2")))
+static inline __m128i fold_sse2( __m128i v )
 {
-	match->filename    = filename;
-	match->line_number = line_number;
-	match->offset      = offset;
-	match->next        = NULL;
+	// the bytes from A to Z are the 26 least after subtracting A + 128
+	__m128i upper = _mm_cmpgt_epi8( _mm_set1_epi8( -128 + 26 ),
+			_mm_sub_epi8( v, _mm_set1_epi8( (char)( 'A' + 128 ) ) ) );
+	return _mm_or_si128( v, _mm_and_si128( upper, _mm_set1_epi8( 'a' - 'A' ) ) );
 }
 
-static match_info_t* 
-bm_search_match(char *file, char* pat, int* delta1, int* delta2, match_info_t** last )
+__attribute__((target("sse2")))
+static uint8_t* fold_search_sse2( bm_search_state_t* state )
 {
-	FILE* fptr;
-	size_t size;
-	uint8_t* buffer, *target;
-	int pat_len, buffer_offset;
-	match_info_t* match_list, *match_last;
-
-	match_list = NULL; match_last = NULL;
-
-	fptr = fopen(file, "rb");
-    if (fptr == NULL) return NULL;
-	fseek( fptr, 0, SEEK_END );
-	size = ftell( fptr );
-	buffer = (uint8_t*)mymalloc( size );
-	if ( buffer != NULL ) {
-		fseek( fptr, 0, SEEK_SET );
-		if ( fread( buffer, 1, size, fptr ) == size ) {
-			pat_len = (int)strlen( pat );
-			buffer_offset = 0;
-
-			bm_search_state_t state;
-			bm_search_set( &state, delta1, delta2, buffer, size, (uint8_t*)pat, pat_len ); 
-			target = boyer_moore( &state );
-			while ( target != NULL ) {
-
-				match_info_t* m = malloc( sizeof( match_info_t ) );
-				bm_search_set_match( m, file, state.line_number, target - buffer );
-				if ( match_list == NULL ) {
-					match_list = m;
-					match_last = m;
-				}
-				else {
-					match_last->next = m;
-					match_last = m;
-				}
-
-				buffer_offset = (target - buffer ) + pat_len;
-				target = NULL;
-				if ( buffer_offset < size ) {
-					state.text = buffer + buffer_offset;
-					state.text_len = size - buffer_offset;
-					target = boyer_moore( &state );
-				}
+	uint8_t* string = state->text;
+	uint8_t* pat = state->pat;
+	uint32_t patlen = state->pat_len;
+	uint32_t i;
+	__m128i first, last, block_first, block_last;
+	unsigned mask;
+
+	if ( patlen < 2 ) return fold_search_tail( state, 0 );
+	first = _mm_set1_epi8( pat[0] );
+	last  = _mm_set1_epi8( pat[patlen - 1] );
+	for ( i = 0; i + patlen - 1 + 16 <= state->text_len; i += 16 ) {
+		block_first = fold_sse2( _mm_loadu_si128( (const __m128i*)( string + i ) ) );
+		block_last  = fold_sse2( _mm_loadu_si128( (const __m128i*)( string + i + patlen - 1 ) ) );
+		mask = _mm_movemask_epi8( _mm_and_si128(
+				_mm_cmpeq_epi8( first, block_first ),
+				_mm_cmpeq_epi8( last, block_last ) ) );
+		while ( mask != 0 ) {
+			int bit = __builtin_ctz( mask );
+			if ( fold_compare( string + i + bit + 1, pat + 1, patlen - 2 ) == 0 ) {
+				return string + i + bit;
 			}
+			mask &= mask - 1;
 		}
-
-		free( buffer );
 	}
-
-	fclose(fptr);
-	if ( last != NULL ) *last = match_last;
-	return match_list;
+	return fold_search_tail( state, i );
 }
 
-static void* bm_search_worker( void* p )
+__attribute__((target("avx2")))
+static inline __m256i fold_avx2( __m256i v )
 {
-	int i = *(int*)p;
-	file_info_t* f;
-	match_info_t* m, *l;
-	worker_info_t* w = &bm_search_data.workers[i];
+	__m256i upper = _mm256_cmpgt_epi8( _mm256_set1_epi8( -128 + 26 ),
+			_mm256_sub_epi8( v, _mm256_set1_epi8( (char)( 'A' + 128 ) ) ) );
+	return _mm256_or_si256( v, _mm256_and_si256( upper, _mm256_set1_epi8( 'a' - 'A' ) ) );
+}
 
-	f = w->file_list;
-	while ( f != NULL ) {
-		m = bm_search_match( f->filename, bm_search_data.pat, 
-				bm_search_data.delta1, bm_search_data.delta2, &l );
-		if ( w->match_list == NULL ) {
-			w->match_list = m;
-			w->match_last = l;
-		}
-		else if ( m != NULL ) {
-			w->match_last->next = m;
-			w->match_last = l;
+__attribute__((target("avx2")))
+static uint8_t* fold_search_avx2( bm_search_state_t* state )
+{
+	uint8_t* string = state->text;
+	uint8_t* pat = state->pat;
+	uint32_t patlen = state->pat_len;
+	uint32_t i;
+	__m256i first, last, block_first, block_last;
+	unsigned mask;
+
+	if ( patlen < 2 ) return fold_search_tail( state, 0 );
+	first = _mm256_set1_epi8( pat[0] );
+	last  = _mm256_set1_epi8( pat[patlen - 1] );
+	for ( i = 0; i + patlen - 1 + 32 <= state->text_len; i += 32 ) {
+		block_first = fold_avx2( _mm256_loadu_si256( (const __m256i*)( string + i ) ) );
+		block_last  = fold_avx2( _mm256_loadu_si256( (const __m256i*)( string + i + patlen - 1 ) ) );
+		mask = (unsigned)_mm256_movemask_epi8( _mm256_and_si256(
+				_mm256_cmpeq_epi8( first, block_first ),
+				_mm256_cmpeq_epi8( last, block_last ) ) );
+		while ( mask != 0 ) {
+			int bit = __builtin_ctz( mask );
+			if ( fold_compare( string + i + bit + 1, pat + 1, patlen - 2 ) == 0 ) {
+				return string + i + bit;
+			}
+			mask &= mask - 1;
 		}
-		f = f->next;
 	}
+	return fold_search_tail( state, i );
 }
+#endif
 
-static void
-bm_search_output_match( match_info_t* m, FILE* output, char* fmt, char* buffer, size_t buffer_len )
+/* Line numbers are only needed where there is a match, so they are counted
+   apart from the search, from the last match to the next one.  The vector
+   counters compare a block with the newline and count the bits of the
+   resulting mask. */
+
+static size_t count_lines_scalar( const uint8_t* from, const uint8_t* to )
 {
-	int offset;
-	static const int PREFIX_MAX_LEN = 64;
-	static const int POSTFIX_MAX_LEN = 64;
-	int rv;
-	const char* p;
-	int char_count;
+	size_t count = 0;
 
-	pthread_mutex_lock( &bm_search_data.output_lock );
+	while ( from < to && ( from = memchr( from, '\n', to - from ) ) != NULL ) {
+		++count;
+		++from;
+	}
+	return count;
+}
 
-	fprintf( output, fmt, m->filename, m->line_number );
+#ifdef BM_SEARCH_SIMD
+__attribute__((target("sse2")))
+static size_t count_lines_sse2( const uint8_t* from, const uint8_t* to )
+{
+	__m128i newline = _mm_set1_epi8( '\n' );
+	size_t count = 0;
 
-	offset = m->offset;
-	{
-		p = (char*)buffer + offset;
-		char_count = PREFIX_MAX_LEN;
-		while ( p >= buffer && !is_line_ending_char( *p ) && char_count > 0) {
-			--p;
-			--char_count;
-		}
-		++p;
-		char_count = PREFIX_MAX_LEN + POSTFIX_MAX_LEN;
-		while ( !is_line_ending_char( *p ) && (p - buffer ) < buffer_len && char_count > 0 ) {
-			if ( is_printable_char( *p ) ) {
-				putc( *p, output );
-				--char_count;
-			}
-			++p;
-		}
-		putc( '\n', output );
+	for ( ; to - from >= 16; from += 16 ) {
+		count += __builtin_popcount( _mm_movemask_epi8( _mm_cmpeq_epi8( newline,
+				_mm_loadu_si128( (const __m128i*)from ) ) ) );
 	}
-	pthread_mutex_unlock( &bm_search_data.output_lock );
+	return count + count_lines_scalar( from, to );
 }
 
-static void 
-bm_search_and_output_match(char *file, char* pat, int* delta1, int* delta2 )
+__attribute__((target("avx2,popcnt")))
+static size_t count_lines_avx2( const uint8_t* from, const uint8_t* to )
 {
-	FILE* fptr;
-	size_t size;
-	uint8_t* buffer, *target;
-	int pat_len, buffer_offset;
-	match_info_t* match_list, *match_last, *m;
-
-	match_list = NULL; match_last = NULL;
-
-	fptr = fopen(file, "rb");
-    if (fptr == NULL) return;
-	fseek( fptr, 0, SEEK_END );
-	size = ftell( fptr );
-	buffer = (uint8_t*)mymalloc( size );
-	if ( buffer != NULL ) {
-		fseek( fptr, 0, SEEK_SET );
-		if ( fread( buffer, 1, size, fptr ) == size ) {
-			pat_len = (int)strlen( pat );
-			buffer_offset = 0;
-
-			bm_search_state_t state;
-			bm_search_set( &state, delta1, delta2, buffer, size, (uint8_t*)pat, pat_len ); 
-			target = boyer_moore( &state );
-			while ( target != NULL ) {
-
-				match_info_t* m = malloc( sizeof( match_info_t ) );
-				bm_search_set_match( m, file, state.line_number, target - buffer );
-				if ( match_list == NULL ) {
-					match_list = m;
-					match_last = m;
-				}
-				else {
-					match_last->next = m;
-					match_last = m;
-				}
-
-				buffer_offset = (target - buffer ) + pat_len;
-				target = NULL;
-				if ( buffer_offset < size ) {
-					state.text = buffer + buffer_offset;
-					state.text_len = size - buffer_offset;
-					target = boyer_moore( &state );
-				}
-			}
-		}
-		/* output the match result */
-		m = match_list;
-		while ( m != NULL ) {
-			bm_search_output_match( m, bm_search_data.output, bm_search_data.format, buffer, size );
-			m = m->next;
-		}
+	__m256i newline = _mm256_set1_epi8( '\n' );
+	size_t count = 0;
 
-		free( buffer );
+	for ( ; to - from >= 32; from += 32 ) {
+		count += __builtin_popcount( (unsigned)_mm256_movemask_epi8( _mm256_cmpeq_epi8( newline,
+				_mm256_loadu_si256( (const __m256i*)from ) ) ) );
+	}
+	return count + count_lines_scalar( from, to );
+}
+#endif
+
+static const uint8_t* bm_search_multi_skip_scalar( const uint8_t* p, const uint8_t* end );
+#ifdef BM_SEARCH_SIMD
+static const uint8_t* bm_search_multi_skip_ssse3( const uint8_t* p, const uint8_t* end );
+static const uint8_t* bm_search_multi_skip_avx2( const uint8_t* p, const uint8_t* end );
+#endif
+
+/* the search, caseless search, line count and multi-literal skip kernels
+   for this processor */
+static uint8_t* (*bm_search_kernel)( bm_search_state_t* state );
+static uint8_t* (*bm_search_fold_kernel)( bm_search_state_t* state );
+static size_t (*count_lines_kernel)( const uint8_t* from, const uint8_t* to );
+static const uint8_t* (*bm_search_multi_kernel)( const uint8_t* p, const uint8_t* end );
+static pthread_once_t bm_search_kernel_once = PTHREAD_ONCE_INIT;
+
+static void bm_search_kernel_init( void )
+{
+	bm_search_kernel = boyer_moore;
+	bm_search_fold_kernel = fold_search_scalar;
+	count_lines_kernel = count_lines_scalar;
+	bm_search_multi_kernel = bm_search_multi_skip_scalar;
+#ifdef BM_SEARCH_SIMD
+	__builtin_cpu_init();
+	if ( __builtin_cpu_supports( "avx2" ) ) {
+		bm_search_kernel = simd_search_avx2;
+		bm_search_fold_kernel = fold_search_avx2;
+		count_lines_kernel = count_lines_avx2;
+		bm_search_multi_kernel = bm_search_multi_skip_avx2;
 	}
-	/* clear the match list */
-	m = match_list;
-	while ( m != NULL ) {
-		match_info_t* temp = m;
-		m = m->next;
-		free( temp );
+	else if ( __builtin_cpu_supports( "sse2" ) ) {
+		bm_search_kernel = simd_search_sse2;
+		bm_search_fold_kernel = fold_search_sse2;
+		count_lines_kernel = count_lines_sse2;
 	}
-
-	fclose(fptr);
-	return;
+	if ( bm_search_multi_kernel == bm_search_multi_skip_scalar && __builtin_cpu_supports( "ssse3" ) ) {
+		bm_search_multi_kernel = bm_search_multi_skip_ssse3;
+	}
+#endif
 }
 
-static void 
-bm_search_and_output_match_with_mmap(char *file, char* pat, int* delta1, int* delta2 )
+/* count the newlines from one position in a text up to another */
+size_t bm_search_count_lines( const char* from, const char* to )
 {
-	mmap_info_t mmap_info;
-	size_t size;
-	uint8_t* buffer, *target;
-	int pat_len, buffer_offset;
-	match_info_t* match_list, *match_last, *m;
+	pthread_once( &bm_search_kernel_once, bm_search_kernel_init );
+	return (*count_lines_kernel)( (const uint8_t*)from, (const uint8_t*)to );
+}
 
-	match_list = NULL; match_last = NULL;
+static void bm_search_number_line( bm_search_state_t* state, uint8_t* target );
 
-	if ( os_mmap( file, &mmap_info ) != 0 ) return;
+/* find the next match in the text, and number its line */
+static uint8_t* bm_search_next( bm_search_state_t* state )
+{
+	uint8_t* target;
+
+	pthread_once( &bm_search_kernel_once, bm_search_kernel_init );
+	if ( state->pat_len == 0 ) return state->text;
+	if ( state->pat_len > state->text_len ) return NULL;
+	target = state->fold ? (*bm_search_fold_kernel)( state ) : (*bm_search_kernel)( state );
+	if ( target != NULL ) {
+		bm_search_number_line( state, target );
+	}
+	return target;
+}
 
-	size = (size_t)mmap_info.size;
-	buffer = (uint8_t*)mmap_info.buffer;
+/* find the first place of a pattern in a text, with the kernel for this
+   processor, or where that needs the tables, without it; if fold is set,
+   the pattern must be in lower case, and is found in either case */
+char* bm_search_find( const char* text, size_t len, const char* pat, size_t pat_len,
+		int fold )
+{
+	bm_search_state_t state;
+
+	pthread_once( &bm_search_kernel_once, bm_search_kernel_init );
+	if ( pat_len == 0 ) return (char*)text;
+	if ( pat_len > len ) return NULL;
+	memset( &state, 0, sizeof(state) );
+	state.text = (uint8_t*)text;
+	state.text_len = len;
+	state.pat = (uint8_t*)pat;
+	state.pat_len = pat_len;
+	if ( fold ) {
+		return (char*)(*bm_search_fold_kernel)( &state );
+	}
+	if ( bm_search_kernel == boyer_moore ) {
+		return (char*)simd_search_tail( &state, 0 );
+	}
+	return (char*)(*bm_search_kernel)( &state );
+}
 
-	if ( buffer != NULL ) {
-		pat_len = (int)strlen( pat );
-		buffer_offset = 0;
+/* number the line of a match after the last one */
+static void bm_search_number_line( bm_search_state_t* state, uint8_t* target )
+{
+	// a short way from the last match it is quicker to count the lines;
+	// the file is only looked up when it is not
+	if ( target - state->line_counted >= LINES_LOOKUP_MIN && state->lines_file != NULL ) {
+		state->lines = linefind( &linecontrol, state->lines_file );
+		state->lines_file = NULL;
+	}
+	if ( target - state->line_counted >= LINES_LOOKUP_MIN && state->lines != NULL ) {
+		state->line_number = lineof( &linecontrol, state->lines,
+				state->base + ( target - state->buffer ) );
+	}
+	else {
+		state->line_number += (*count_lines_kernel)( state->line_counted, target );
+	}
+	state->line_counted = target;
+}
 
-		bm_search_state_t state;
-		bm_search_set( &state, delta1, delta2, buffer, size, (uint8_t*)pat, pat_len ); 
-		target = boyer_moore( &state );
-		while ( target != NULL ) {
+static int is_printable_char( uint8_t c )
+{
+	return c >= 20 && c <= 126;
+}
 
-			match_info_t* m = malloc( sizeof( match_info_t ) );
-			bm_search_set_match( m, file, state.line_number, target - buffer );
-			if ( match_list == NULL ) {
-				match_list = m;
-				match_last = m;
-			}
-			else {
-				match_last->next = m;
-				match_last = m;
-			}
+/* make room for n more characters in an output buffer */
+static char* bm_search_out_reserve( output_buffer_t* out, size_t n )
+{
+	if ( out->len + n > out->size ) {
+		out->size = max( 2 * out->size, out->len + n + OUTPUT_BUFFER_INC );
+		out->text = (char*)myrealloc( out->text, out->size );
+	}
+	return out->text + out->len;
+}
 
-			buffer_offset = (target - buffer ) + pat_len;
-			target = NULL;
-			if ( buffer_offset < size ) {
-				state.text = buffer + buffer_offset;
-				state.text_len = size - buffer_offset;
-				target = boyer_moore( &state );
-			}
-		}
+/* put the printable characters of the line with the target in an output
+   buffer, and return the end of the line */
+static uint8_t* bm_search_out_line( output_buffer_t* out, uint8_t* buffer, size_t size,
+		uint8_t* target )
+{
+	uint8_t* p, *end;
+	char* s;
 
-		/* output the match result */
-		m = match_list;
-		while ( m != NULL ) {
-			bm_search_output_match( m, bm_search_data.output, bm_search_data.format, buffer, size );
-			m = m->next;
+	for ( p = target; p > buffer && p[-1] != '\n'; --p ) {
+	}
+	end = memchr( target, '\n', buffer + size - target );
+	if ( end == NULL ) end = buffer + size;
+	s = bm_search_out_reserve( out, end - p + 1 );
+	for ( ; p < end; ++p ) {
+		if ( is_printable_char( *p ) ) {
+			*s++ = *p;
 		}
 	}
-	/* clear the match list */
-	m = match_list;
-	while ( m != NULL ) {
-		match_info_t* temp = m;
-		m = m->next;
-		free( temp );
+	*s++ = '\n';
+	out->len = s - out->text;
+	return end;
+}
+
+/* put the file name and line number of a match in an output buffer */
+void bm_search_out_head( output_buffer_t* out, char* format, char* file, long line_number )
+{
+	char* s;
+	size_t room;
+	int n;
+
+	room = strlen( file ) + OUTPUT_BUFFER_LINE;
+	s = bm_search_out_reserve( out, room );
+	n = snprintf( s, room, format, file, line_number );
+	if ( n >= room ) {
+		s = bm_search_out_reserve( out, n + 1 );
+		snprintf( s, n + 1, format, file, line_number );
 	}
+	out->len += n;
+}
 
-	os_munmap( &mmap_info );
-	return;
+/* put text in an output buffer */
+void bm_search_out_text( output_buffer_t* out, const char* text, size_t len )
+{
+	memcpy( bm_search_out_reserve( out, len ), text, len );
+	out->len += len;
 }
 
-static void* bm_search_and_output_worker( void* p )
+/* put the file name and line number of a match, and the printable
+   characters of its line, in an output buffer */
+static void bm_search_out_match( output_buffer_t* out, char* format, char* file,
+		int line_number, uint8_t* buffer, size_t size, uint8_t* target )
 {
-	int i = *(int*)p;
-	file_info_t* f;
-	worker_info_t* w = &bm_search_data.workers[i];
-	char path[PATHLEN + 1];
-	char* filename;
-	filename = filepath( f->filename, path, PATHLEN + 1 );
+	bm_search_out_head( out, format, file, (long)line_number );
+	bm_search_out_line( out, buffer, size, target );
+}
 
-	f = w->file_list;
-	while ( f != NULL ) {
-		bm_search_and_output_match( filename, bm_search_data.pat, 
-				bm_search_data.delta1, bm_search_data.delta2 );
-		f = f->next;
+/* write out and empty an output buffer */
+void bm_search_out_flush( output_buffer_t* out, FILE* output )
+{
+	if ( out->len > 0 ) {
+		fwrite( out->text, 1, out->len, output );
+		out->len = 0;
 	}
 }
 
-extern int thread_worker_count;
-
-int bm_search_worker_init( FILE* output, char* fmt, char* pat, int file_count )
+void bm_search_out_free( output_buffer_t* out )
 {
-	int i;
-	int patlen;
-	if ( thread_worker_count < 2 ) return -1;
+	free( out->text );
+	out->text = NULL;
+	out->len = out->size = 0;
+}
 
-	bm_search_data.output     = output;
-	bm_search_data.format     = fmt;
-	bm_search_data.file_count = file_count;
-	bm_search_data.pat        = pat;
+/* How a file is read for a search depends on its size.  A small file is
+   read whole into a buffer the thread keeps for the next one.  A large file
+   is mapped, and the system told it is read in order, so it reads ahead
+   and can drop the pages passed.  A huge file is read a block of whole
+   lines at a time into the thread's buffer, so a search thread never holds
+   more than READ_CHUNK of a file, besides a longer line, or READ_MAPPED of
+   a mapping.  When there are workers, a file of SPLIT_MIN or more is split
+   into blocks of READ_CHUNK that are searched at once on the pool. */
 
-	patlen = strlen( pat );
+#define READ_SMALL  ( 1 << 20 )  // largest file read whole
+#define READ_MAPPED ( 64 << 20 ) // largest file mapped
+#define READ_CHUNK  ( 4 << 20 )  // block of a huge file read at a time
+#define SPLIT_MIN   ( 16 << 20 ) // smallest file split into blocks
+#define SPLIT_MORE  65536 // read at a time past a block to end its last line
+#define SPLIT_READ  ( READ_CHUNK + 1 + SPLIT_MORE ) // a block, the byte before it and one read past it
 
-	bm_search_data.delta1 = (int*)malloc( ALPHABET_LEN * sizeof(int) );
-	bm_search_data.delta2 = (int*)malloc( patlen * sizeof(int) );
+enum { READ_WHOLE, READ_MAP, READ_STREAM, READ_SPLIT, READ_STRATEGIES };
 
-    make_delta1(bm_search_data.delta1, pat, patlen);
-    make_delta2(bm_search_data.delta2, pat, patlen);
+typedef struct {
+	int strategy;
+	int fd;
+	mmap_info_t map;
+	long long size; // of the file
+	long long offset; // of the next read
+	uint8_t* text; // the block of lines read
+	size_t len;
+	size_t base; // its file offset
+	size_t filled; // bytes in the buffer, from the start of the block
+	int done; // the block is the last
+	double start;
+} bm_search_read_t;
 
-	bm_search_data.workers = malloc( sizeof(worker_info_t) * thread_worker_count );
-	for ( i = 0; i < thread_worker_count; ++i ) {
-		bm_search_data.workers[i].file_list  = NULL;
-		bm_search_data.workers[i].file_last  = NULL;
-		bm_search_data.workers[i].match_list = NULL;
-		bm_search_data.workers[i].match_last = NULL;
-	}
+typedef struct {
+	uint8_t* data;
+	size_t size;
+} read_buffer_t;
+
+static pthread_key_t bm_search_read_key;
+static pthread_once_t bm_search_read_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t bm_search_read_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* files read by each strategy, their size and the time taken to search them */
+static struct {
+	long files;
+	double bytes;
+	double seconds;
+} bm_search_read_stats[READ_STRATEGIES];
 
-	 pthread_mutex_init( &bm_search_data.output_lock, NULL );
-	 pthread_mutex_init( &bm_search_data.global_worker_lock, NULL );
-	 pthread_cond_init( &bm_search_data.global_worker_cond, NULL );
+static void bm_search_read_free( void* p )
+{
+	read_buffer_t* b = (read_buffer_t*)p;
 
-	 bm_search_data.global_worker.file_list = NULL;
-	 bm_search_data.global_worker.file_last = NULL;
+	free( b->data );
+	free( b );
+}
 
-	 bm_search_data.finish_of_adding_files = 0;
+static void bm_search_read_key_init( void )
+{
+	pthread_key_create( &bm_search_read_key, bm_search_read_free );
+}
 
+/* the calling thread's buffer, made at least size bytes */
+static read_buffer_t* bm_search_read_buffer( size_t size )
+{
+	read_buffer_t* b;
+
+	pthread_once( &bm_search_read_once, bm_search_read_key_init );
+	b = (read_buffer_t*)pthread_getspecific( bm_search_read_key );
+	if ( b == NULL ) {
+		b = (read_buffer_t*)mycalloc( 1, sizeof( read_buffer_t ) );
+		pthread_setspecific( bm_search_read_key, b );
+	}
+	if ( b->size < size ) {
+		b->size = size;
+		free( b->data );
+		b->data = (uint8_t*)mymalloc( size );
+	}
+	return b;
+}
+
+static void bm_search_read_trim( void );
+static void bm_search_read_count( int strategy, long long size, double start );
+
+/* open a file to read for a search; returns -1 if it cannot be read */
+static int bm_search_read_open( bm_search_read_t* r, char* file )
+{
+	r->start = os_get_time();
+	r->fd = -1;
+	r->offset = 0;
+	r->text = NULL;
+	r->len = 0;
+	r->base = 0;
+	r->filled = 0;
+	r->done = 0;
+	if ( ( r->size = os_file_size( file ) ) < 0 ) return -1;
+	if ( r->size > READ_SMALL && r->size <= READ_MAPPED && os_mmap( file, &r->map ) == 0 ) {
+		os_madvise_sequential( &r->map );
+		r->strategy = READ_MAP;
+		return 0;
+	}
+	if ( ( r->fd = os_open_read( file ) ) < 0 ) return -1;
+	r->strategy = r->size <= READ_SMALL ? READ_WHOLE : READ_STREAM;
 	return 0;
 }
 
-void bm_search_worker_deinit( void )
+/* read the next block of whole lines of the file, or at its end of the
+   rest, into text and len; returns 0 if there are none */
+static int bm_search_read_next( bm_search_read_t* r )
 {
-	file_info_t* f, *temp_f;
-	match_info_t* m, *temp_m;
-	int i;
-	for ( i = 0; i < thread_worker_count; ++i ) {
-		f = bm_search_data.workers[i].file_list;
-		while ( f != NULL ) {
-			temp_f = f->next;
-			free( f );
-			f = temp_f;
+	read_buffer_t* b;
+	uint8_t* p;
+	long n;
+
+	if ( r->done ) return 0;
+	switch ( r->strategy ) {
+	case READ_WHOLE:
+		b = bm_search_read_buffer( r->size + 1 );
+		n = os_pread( r->fd, (char*)b->data, (long)r->size, 0 );
+		r->done = 1;
+		r->text = b->data;
+		r->len = n > 0 ? n : 0;
+		return r->len > 0;
+
+	case READ_MAP:
+		r->done = 1;
+		r->text = (uint8_t*)r->map.buffer;
+		r->len = r->map.size;
+		return r->len > 0;
+	}
+
+	// the line begun at the end of the last block starts the next
+	b = bm_search_read_buffer( READ_CHUNK );
+	r->base += r->len;
+	r->filled -= r->len;
+	memmove( b->data, b->data + r->len, r->filled );
+	for ( ;; ) {
+		if ( r->filled == b->size ) {
+			// a line longer than the buffer
+			b->size *= 2;
+			b->data = (uint8_t*)myrealloc( b->data, b->size );
+		}
+		n = os_pread( r->fd, (char*)b->data + r->filled, b->size - r->filled, r->offset );
+		if ( n <= 0 ) {
+			r->done = 1;
+			r->text = b->data;
+			r->len = r->filled;
+			return r->len > 0;
+		}
+		r->offset += n;
+		r->filled += n;
+		for ( p = b->data + r->filled; p > b->data && p[-1] != '\n'; --p ) {
 		}
-		m = bm_search_data.workers[i].match_list;
-		while ( m != NULL ) {
-			temp_m = m->next;
-			free( m );
-			m = temp_m;
+		if ( p > b->data ) {
+			r->text = b->data;
+			r->len = p - b->data;
+			return 1;
 		}
 	}
+}
 
-	f = bm_search_data.global_worker.file_list;
-	while ( f != NULL ) {
-		temp_f = f->next;
-		free( f );
-		f = temp_f;
+/* close a file read for a search, and count it with the files read as it
+   was */
+static void bm_search_read_close( bm_search_read_t* r )
+{
+	if ( r->strategy == READ_MAP ) {
+		os_munmap( &r->map );
 	}
+	else {
+		os_close( r->fd );
+	}
+	if ( r->strategy == READ_STREAM ) {
+		bm_search_read_trim();
+	}
+	bm_search_read_count( r->strategy, r->size, r->start );
+}
 
-	pthread_cond_destroy( &bm_search_data.global_worker_cond );
-	pthread_mutex_destroy( &bm_search_data.global_worker_lock );
-	pthread_mutex_destroy( &bm_search_data.output_lock );
-
-	free( bm_search_data.workers );
-	free( bm_search_data.delta1 );
-	free( bm_search_data.delta2 );
-
-	bm_search_data.workers = NULL;
-	bm_search_data.delta1 = NULL;
-	bm_search_data.delta2 = NULL;
+/* free the thread's buffer if it was grown for a long line */
+static void bm_search_read_trim( void )
+{
+	read_buffer_t* b;
 
-	bm_search_data.output = NULL;
-	bm_search_data.pat    = NULL;
+	b = bm_search_read_buffer( 0 );
+	if ( b->size > SPLIT_READ ) {
+		free( b->data );
+		b->data = NULL;
+		b->size = 0;
+	}
+}
 
-	bm_search_data.global_worker.file_list = NULL;
-	bm_search_data.global_worker.file_last = NULL;
+/* count a file read by a strategy, from the time it was opened */
+static void bm_search_read_count( int strategy, long long size, double start )
+{
+	double seconds;
+
+	seconds = os_get_time() - start;
+	pthread_mutex_lock( &bm_search_read_lock );
+	bm_search_read_stats[strategy].files += 1;
+	bm_search_read_stats[strategy].bytes += (double)size;
+	bm_search_read_stats[strategy].seconds += seconds;
+	pthread_mutex_unlock( &bm_search_read_lock );
+}
 
-	bm_search_data.finish_of_adding_files = 0;
+/* forget the files read, at the start of a search */
+static void bm_search_read_reset( void )
+{
+	pthread_mutex_lock( &bm_search_read_lock );
+	memset( bm_search_read_stats, 0, sizeof( bm_search_read_stats ) );
+	pthread_mutex_unlock( &bm_search_read_lock );
 }
 
-int bm_search_worker_add( int index, char* file )
+/* the files the last search read by each strategy, and the rate they were
+   searched at, in a message; it is empty if no files were read */
+void bm_search_read_report( char* msg, size_t size )
 {
-	if ( index < 0 || index >= bm_search_data.file_count ) return -1;
+	static char* names[READ_STRATEGIES] = { "read", "mapped", "streamed", "split" };
+	size_t len = 0;
+	double seconds;
+	int i;
 
-	int file_count_for_on_worker = bm_search_data.file_count / thread_worker_count;
+	msg[0] = '\0';
+	pthread_mutex_lock( &bm_search_read_lock );
+	for ( i = 0; i < READ_STRATEGIES && len < size; ++i ) {
+		if ( bm_search_read_stats[i].files == 0 ) continue;
+		// the time is of the threads together, so it is the rate of one
+		seconds = bm_search_read_stats[i].seconds;
+		len += snprintf( msg + len, size - len, "%s%s %ld files, %.1fMB at %.0fMB/s",
+				len == 0 ? "cscope: " : "; ", names[i], bm_search_read_stats[i].files,
+				bm_search_read_stats[i].bytes / ( 1 << 20 ),
+				seconds > 0 ? bm_search_read_stats[i].bytes / ( 1 << 20 ) / seconds : 0.0 );
+	}
+	pthread_mutex_unlock( &bm_search_read_lock );
+}
 
-	int id = index / file_count_for_on_worker;
-	if ( id > thread_worker_count - 1 ) id = thread_worker_count - 1;
+/* A split file's blocks are searched for the lines that start in them,
+   reading on past their end to the end of the last, so each line is
+   searched whole, and once.  A match, which has no newline, is never in two
+   blocks, and so the blocks need not overlap.  Each block numbers its
+   matches from its start, and counts its lines, and the blocks are put
+   together in order, a window of them at a time, numbering the lines from
+   the counts of those before. */
 
+typedef struct {
+	long line; // the line of a match in its block, from 0
+	size_t end; // the end of its line in the block's lines
+} split_match_t;
 
-	file_info_t* f = malloc( sizeof( file_info_t ) );
-	f->filename = file;
-	f->next = NULL;
-	if ( bm_search_data.workers[id].file_list == NULL ) {
-		bm_search_data.workers[id].file_list = f;
-		bm_search_data.workers[id].file_last = f;
+typedef struct {
+	char* file;
+	char* pat;
+	int* delta1;
+	int* delta2;
+	long long start; // the block
+	long long end;
+	output_buffer_t lines; // the lines of its matches
+	split_match_t* matches;
+	int count;
+	int room;
+	long newlines; // in the lines that start in it
+	int status;
+} split_block_t;
+
+/* pool task searching a block of a split file */
+static void bm_search_split_block( void* p )
+{
+	split_block_t* k = (split_block_t*)p;
+	read_buffer_t* b;
+	bm_search_state_t state;
+	uint8_t* text, *target, *q;
+	long long from;
+	size_t len, own, buffer_offset;
+	long n;
+	int fd;
+	int pat_len = (int)strlen( k->pat );
+
+	if ( ( fd = os_open_read( k->file ) ) < 0 ) {
+		k->status = -1;
+		return;
 	}
-	else {
-		bm_search_data.workers[id].file_last->next = f;
-		bm_search_data.workers[id].file_last = f;
+	// from the byte before the block, to see if a line starts at it
+	from = k->start > 0 ? k->start - 1 : 0;
+	b = bm_search_read_buffer( SPLIT_READ );
+	n = os_pread( fd, (char*)b->data, (long)( k->end - from ), from );
+	len = n > 0 ? n : 0;
+	own = 0;
+	if ( k->start > 0 ) {
+		q = memchr( b->data, '\n', len );
+		own = q != NULL ? q - b->data + 1 : len;
 	}
 
-	return 0;
+	// read on to the end of the last line that starts in the block
+	while ( own < len && b->data[len - 1] != '\n' ) {
+		if ( len + SPLIT_MORE > b->size ) {
+			b->size *= 2;
+			b->data = (uint8_t*)myrealloc( b->data, b->size );
+		}
+		n = os_pread( fd, (char*)b->data + len, SPLIT_MORE, from + len );
+		if ( n <= 0 ) break;
+		q = memchr( b->data + len, '\n', n );
+		len = q != NULL ? q - b->data + 1 : len + n;
+	}
+	os_close( fd );
+
+	k->newlines = 0;
+	if ( own < len ) {
+		text = b->data + own;
+		len -= own;
+		bm_search_set( &state, k->delta1, k->delta2, text, len, (uint8_t*)k->pat, pat_len );
+		state.fold = bm_search_data.fold;
+		state.line_number = 0;
+		target = bm_search_next( &state );
+		while ( target != NULL ) {
+			if ( k->count == k->room ) {
+				k->room = k->room == 0 ? 64 : 2 * k->room;
+				k->matches = (split_match_t*)myrealloc( k->matches,
+						k->room * sizeof( split_match_t ) );
+			}
+			bm_search_out_line( &k->lines, text, len, target );
+			k->matches[k->count].line = state.line_number;
+			k->matches[k->count].end = k->lines.len;
+			++k->count;
+
+			buffer_offset = (target - text ) + pat_len;
+			target = NULL;
+			if ( buffer_offset < len ) {
+				state.text = text + buffer_offset;
+				state.text_len = len - buffer_offset;
+				target = bm_search_next( &state );
+			}
+		}
+		k->newlines = (*count_lines_kernel)( text, text + len );
+	}
+	bm_search_read_trim();
 }
 
-static void bm_search_print_match( match_info_t* m, FILE* output, char* fmt )
+/* search a file in blocks on the pool, and output its matches in order;
+   returns -1 if the file cannot be read */
+static int bm_search_file_split( char *file, char* pat, int* delta1, int* delta2,
+		output_buffer_t* out, char* format, long long size )
 {
-	FILE* fptr;
-	int offset;
-	static const int BUF_LEN = 128;
-	char buf[BUF_LEN];
-	int rv;
-	const char* p;
-
-	fprintf( output, fmt, m->filename, m->line_number );
-
-	fptr = fopen(m->filename, "rb");
-	if ( fptr == NULL ) return;
-
-	offset = m->offset - BUF_LEN / 2;
-	if (offset < 0 ) offset = 0;
-	fseek( fptr, offset, SEEK_SET );
-	rv = fread( buf, 1, BUF_LEN, fptr );
-	if ( rv > 0 ) {
-		p = buf + BUF_LEN / 2;
-		while ( *p != '\n' && p >= buf ) {
-			--p;
+	POOLGROUP group;
+	split_block_t* blocks, *k;
+	long long start;
+	double time;
+	long line_number = 1;
+	size_t from;
+	int window, count, status = 0;
+	int i, j;
+
+	time = os_get_time();
+	window = 2 * ( poolsize() + 1 );
+	blocks = (split_block_t*)mycalloc( window, sizeof( split_block_t ) );
+	for ( start = 0; start < size && status == 0 && !bm_search_interrupted; ) {
+		memset( &group, 0, sizeof( group ) );
+		for ( count = 0; count < window && start < size; ++count ) {
+			k = &blocks[count];
+			k->file = file;
+			k->pat = pat;
+			k->delta1 = delta1;
+			k->delta2 = delta2;
+			k->start = start;
+			k->end = size - start > READ_CHUNK ? start + READ_CHUNK : size;
+			k->lines.len = 0;
+			k->count = 0;
+			k->status = 0;
+			start = k->end;
+			poolsubmit( &group, bm_search_split_block, k );
 		}
-		++p;
-		while ( *p != '\n' && (p - buf ) < BUF_LEN  ) {
-			if ( is_printable_char( *p ) ) {
-				putc( *p, output );
+		poolwait( &group );
+
+		for ( i = 0; i < count; ++i ) {
+			k = &blocks[i];
+			if ( k->status != 0 ) {
+				status = -1;
+				break;
 			}
-			++p;
+			from = 0;
+			for ( j = 0; j < k->count; ++j ) {
+				bm_search_out_head( out, format, file, line_number + k->matches[j].line );
+				bm_search_out_text( out, k->lines.text + from, k->matches[j].end - from );
+				from = k->matches[j].end;
+			}
+			line_number += k->newlines;
 		}
-		putc( '\n', output );
 	}
-	fclose( fptr );
+	for ( i = 0; i < window; ++i ) {
+		bm_search_out_free( &blocks[i].lines );
+		free( blocks[i].matches );
+	}
+	free( blocks );
+	bm_search_read_count( READ_SPLIT, start, time );
+	return status;
 }
 
-void bm_search_print_out( void )
+/* search a file, and output each match's file name, line number and line;
+   returns -1 if the file cannot be read */
+static int bm_search_file( char *file, char* pat, int* delta1, int* delta2,
+		output_buffer_t* out, char* format )
 {
-	int i;
-	match_info_t* m;
+	bm_search_read_t r;
+	size_t buffer_offset;
+	uint8_t* target;
+	int pat_len;
+	int line_number = 1;
+	long long size;
+	bm_search_state_t state;
 
-	for ( i = 0; i < thread_worker_count; ++i ) {
-		m = bm_search_data.workers[i].match_list;
-		while ( m != NULL ) {
-			bm_search_print_match( m, bm_search_data.output, bm_search_data.format );
-			m = m->next;
+	// a large file is split for the workers, when there are any
+	size = os_file_size( file );
+	if ( size >= SPLIT_MIN && poolsize() > 0 && strchr( pat, '\n' ) == NULL ) {
+		return bm_search_file_split( file, pat, delta1, delta2, out, format, size );
+	}
+	if ( bm_search_read_open( &r, file ) != 0 ) return(-1);
+	pat_len = (int)strlen( pat );
+	while ( bm_search_read_next( &r ) ) {
+		bm_search_set( &state, delta1, delta2, r.text, r.len, (uint8_t*)pat, pat_len ); 
+		state.fold = bm_search_data.fold;
+		state.line_number = line_number;
+		state.base = r.base;
+		bm_search_use_lines( &state, file );
+		target = bm_search_next( &state );
+		while ( target != NULL ) {
+			bm_search_out_match( out, format, file, state.line_number, r.text, r.len, target );
+
+			buffer_offset = (target - r.text ) + pat_len;
+			target = NULL;
+			if ( buffer_offset < r.len ) {
+				state.text = r.text + buffer_offset;
+				state.text_len = r.len - buffer_offset;
+				target = bm_search_next( &state );
+			}
+		}
+		// the lines of the block, for those of the next
+		if ( !r.done ) {
+			line_number = state.line_number +
+				(*count_lines_kernel)( state.line_counted, r.text + r.len );
 		}
 	}
+	bm_search_read_close( &r );
+	return 0;
 }
 
-
-int bm_search_worker_run( void )
+int bm_search(char *file, FILE *output, char *format, char* pat)
 {
-	int* thread_id;
-	pthread_t* thread;
-	int i, rv;
+	output_buffer_t out = { NULL, 0, 0 };
+	bm_search_state_t tables;
+	int rv;
+
+	bm_search_init( &tables, NULL, 0, (uint8_t*)pat, (uint32_t)strlen( pat ) );
+	rv = bm_search_file( file, pat, tables.delta1, tables.delta2, &out, format );
+	bm_search_out_flush( &out, output );
+	bm_search_out_free( &out );
+	bm_search_deinit( &tables );
+	return rv;
+}
 
-	thread = malloc( sizeof( pthread_t ) * thread_worker_count );
-	thread_id = malloc( sizeof(int)*thread_worker_count );
+int bm_search_worker_init( FILE* output, char* fmt, char* pat, int caseless )
+{
+	int i;
+	int patlen;
 
-	for ( i = 0; i < thread_worker_count; ++i ) {
-		thread_id[i] = i;
-		rv = pthread_create( &thread[i], NULL, bm_search_worker,  &thread_id[i] );
-		if ( rv != 0 ) {
-			return -1;
+	bm_search_data.output     = output;
+	bm_search_data.format     = fmt;
+	bm_search_data.pat        = pat;
+	bm_search_data.fold       = caseless;
+	bm_search_read_reset();
+
+	// a caseless search folds the text to lower case, and so the pattern
+	if ( caseless ) {
+		pat = bm_search_data.pat = my_strdup( pat );
+		for ( i = 0; pat[i] != '\0'; ++i ) {
+			pat[i] = FOLD( (uint8_t)pat[i] );
 		}
 	}
 
-	/* block until all threads finish. */
-	for ( i = 0; i < thread_worker_count; ++i ) {
-		pthread_join( thread[i], NULL );
-	}
+	patlen = strlen( pat );
+
+	bm_search_data.delta1 = (int*)malloc( ALPHABET_LEN * sizeof(int) );
+	bm_search_data.delta2 = (int*)malloc( patlen * sizeof(int) );
 
-	/* print out the result */
-	bm_search_print_out();
+    make_delta1(bm_search_data.delta1, pat, patlen);
+    make_delta2(bm_search_data.delta2, pat, patlen);
 
 	return 0;
 }
 
-int bm_search_and_output_worker_run( void )
+void bm_search_worker_deinit( void )
 {
-	int* thread_id;
-	pthread_t* thread;
-	int i, rv;
-
-	thread = malloc( sizeof( pthread_t ) * thread_worker_count );
-	thread_id = malloc( sizeof(int)*thread_worker_count );
+	free( bm_search_data.delta1 );
+	free( bm_search_data.delta2 );
 
-	for ( i = 0; i < thread_worker_count; ++i ) {
-		thread_id[i] = i;
-		rv = pthread_create( &thread[i], NULL, bm_search_and_output_worker,  &thread_id[i] );
-		if ( rv != 0 ) {
-			return -1;
-		}
-	}
+	bm_search_data.delta1 = NULL;
+	bm_search_data.delta2 = NULL;
 
-	/* block until all threads finish. */
-	for ( i = 0; i < thread_worker_count; ++i ) {
-		pthread_join( thread[i], NULL );
+	if ( bm_search_data.fold ) {
+		free( bm_search_data.pat );
 	}
-
-	return 0;
+	bm_search_data.output = NULL;
+	bm_search_data.pat    = NULL;
+	bm_search_data.fold   = 0;
 }
 
 /*****************************************************************************/
 
-static void* bm_search_and_output_from_global_worker( void* p )
+/* pool task searching a file into the output buffer of its slot */
+static void bm_search_and_output_file( void* p )
 {
-	int i = *(int*)p;
-	(void)i;
-	file_info_t* f;
+	output_slot_t* slot = (output_slot_t*)p;
 	char path[PATHLEN + 1];
 	char* filename;
 
-	while ( 1 ) {
-		pthread_mutex_lock( &bm_search_data.global_worker_lock );
+	filename = filepath( slot->file, path, PATHLEN + 1 );
+	slot->status = (*slot->search)( filename, &slot->output );
+}
 
-		while ( bm_search_data.global_worker.file_list == NULL ) {
-			if ( bm_search_data.finish_of_adding_files ) {
-				pthread_mutex_unlock( &bm_search_data.global_worker_lock );
-				pthread_exit( NULL );
-			}
-			pthread_cond_wait( &bm_search_data.global_worker_cond, &bm_search_data.global_worker_lock );
-		}
-		
-		f = bm_search_data.global_worker.file_list;
-		bm_search_data.global_worker.file_list = bm_search_data.global_worker.file_list->next;
-		if ( bm_search_data.global_worker.file_list == NULL ) {
-			bm_search_data.global_worker.file_last = NULL;
+/* search the files on the pool, and write their output in the order of the
+   file list; the files that cannot be read are reported as they are reached.
+   An interrupt stops the search once the files being searched are done, and
+   is then passed on */
+void bm_search_ordered_run( char** file_name_list, int file_count, FILE* output,
+		bm_search_file_fn search )
+{
+	output_slot_t* slots;
+	output_slot_t* slot;
+	sighandler_t savesig;
+	int window;
+	int i;
+
+	/* a task for each file, so idle workers take the files left, with the
+	   files up to a window ahead of the one being output searched into
+	   buffers of their own. The buffers are written in the order of the
+	   file list, so the output is the same however the files are shared
+	   out, and no lock is needed to write it. */
+	bm_search_read_reset();
+	bm_search_interrupted = 0;
+	savesig = signal( SIGINT, bm_search_interrupt );
+	window = file_count < OUTPUT_WINDOW ? file_count : OUTPUT_WINDOW;
+	slots = (output_slot_t*)mycalloc( window, sizeof( output_slot_t ) );
+	for ( i = 0; i < window; ++i ) {
+		slots[i].file = file_name_list[i];
+		slots[i].search = search;
+		poolsubmit( &slots[i].group, bm_search_and_output_file, &slots[i] );
+	}
+	for ( i = 0; i < file_count && !bm_search_interrupted; ++i ) {
+		slot = &slots[i % window];
+		progress( "Search", searchcount, file_count );
+
+		/* block until the file is searched, searching others meanwhile */
+		poolwait( &slot->group );
+		bm_search_out_flush( &slot->output, output );
+		if ( slot->status < 0 ) {
+			posterr( "Cannot open file %s", slot->file );
 		}
-		pthread_mutex_unlock( &bm_search_data.global_worker_lock );
 
-		filename = filepath( f->filename, path, PATHLEN + 1 );
-		bm_search_and_output_match( 
-				filename, bm_search_data.pat, 
-				bm_search_data.delta1, bm_search_data.delta2 );
+		if ( i + window < file_count && !bm_search_interrupted ) {
+			slot->file = file_name_list[i + window];
+			poolsubmit( &slot->group, bm_search_and_output_file, slot );
+		}
+	}
 
-		free( f );
+	/* after an interrupt no task may be left using the slots, or the data
+	   of the search, when the interrupt is passed on */
+	for ( i = 0; i < window; ++i ) {
+		poolwait( &slots[i].group );
+		bm_search_out_free( &slots[i].output );
+	}
+	free( slots );
+	signal( SIGINT, savesig );
+	if ( bm_search_interrupted ) {
+		raise( SIGINT );
 	}
 }
 
-static void bm_search_worker_add_into_global( char* file )
+static int bm_search_file_task( char* file, output_buffer_t* out )
 {
-	file_info_t* f = malloc( sizeof( file_info_t ) );
-	f->filename = file;
-	f->next = NULL;
+	return bm_search_file( file, bm_search_data.pat, 
+			bm_search_data.delta1, bm_search_data.delta2,
+			out, bm_search_data.format );
+}
 
-	pthread_mutex_lock( &bm_search_data.global_worker_lock );
+int bm_search_and_output_global_worker_run( char** file_name_list, int file_count )
+{
+	if ( file_count <= 0 ) return -1;
 
-	if ( bm_search_data.global_worker.file_list == NULL ) {
-		bm_search_data.global_worker.file_list = f;
-		bm_search_data.global_worker.file_last = f;
-	}
-	else {
-		bm_search_data.global_worker.file_last->next = f;
-		bm_search_data.global_worker.file_last = f;
-	}
+	bm_search_ordered_run( file_name_list, file_count, bm_search_data.output,
+			bm_search_file_task );
 
-	pthread_cond_signal( &bm_search_data.global_worker_cond );
-	pthread_mutex_unlock( &bm_search_data.global_worker_lock );
+	return 0;
 }
 
+/* Multi-literal search: any of a set of strings is found in one pass over
+   each file.  The strings are compiled into an Aho-Corasick automaton,
+   made into a full table over the classes of bytes the strings use.  While
+   the automaton is in its start state, no string has been begun, so the
+   text is skipped to the next position where the first two bytes of one
+   could be.  The vector kernels find the candidates 16 or 32 positions at
+   a time with nibble masks of the first and second bytes of the strings,
+   in 8 buckets by their first byte, and the candidates are checked against
+   the exact set of the strings' first byte pairs. */
 
-int bm_search_and_output_global_worker_run( char** file_name_list, int file_count )
+#define MULTI_BUCKETS 8
+
+static struct {
+	char** needles;
+	char** labels;
+	int* lengths;
+	int count;
+	uint8_t cls[ALPHABET_LEN]; // the class of each byte, 0 for those in no needle
+	int class_count;
+	int* delta; // the next state by state and byte class
+	int* match; // the needle ending at each state, or -1
+	uint8_t pairs[ALPHABET_LEN * ALPHABET_LEN / 8]; // the first two bytes of a needle
+	uint8_t single[ALPHABET_LEN]; // the needles of one byte
+	uint8_t lo1[16], hi1[16], lo2[16], hi2[16]; // the buckets of the first and second byte nibbles
+	char* format;
+} bm_search_multi_data;
+
+/* could a needle start at p */
+static int bm_search_multi_candidate( const uint8_t* p, const uint8_t* end )
 {
-	int* thread_id;
-	pthread_t* thread;
-	int i, rv;
+	unsigned pair;
 
-	if ( file_count <= 0 ) return -1;
+	if ( end - p < 2 ) return bm_search_multi_data.single[*p];
+	pair = ( p[0] << 8 ) | p[1];
+	return bm_search_multi_data.pairs[pair >> 3] & ( 1 << ( pair & 7 ) );
+}
+
+static const uint8_t* bm_search_multi_skip_scalar( const uint8_t* p, const uint8_t* end )
+{
+	while ( p < end && !bm_search_multi_candidate( p, end ) ) {
+		++p;
+	}
+	return p;
+}
+
+#ifdef BM_SEARCH_SIMD
+__attribute__((target("ssse3")))
+static const uint8_t* bm_search_multi_skip_ssse3( const uint8_t* p, const uint8_t* end )
+{
+	__m128i lo1 = _mm_loadu_si128( (const __m128i*)bm_search_multi_data.lo1 );
+	__m128i hi1 = _mm_loadu_si128( (const __m128i*)bm_search_multi_data.hi1 );
+	__m128i lo2 = _mm_loadu_si128( (const __m128i*)bm_search_multi_data.lo2 );
+	__m128i hi2 = _mm_loadu_si128( (const __m128i*)bm_search_multi_data.hi2 );
+	__m128i nibble = _mm_set1_epi8( 0x0f );
+	__m128i v0, v1, m;
+	unsigned mask;
+
+	for ( ; end - p >= 17; p += 16 ) {
+		v0 = _mm_loadu_si128( (const __m128i*)p );
+		v1 = _mm_loadu_si128( (const __m128i*)( p + 1 ) );
+		m = _mm_and_si128(
+			_mm_and_si128( _mm_shuffle_epi8( lo1, _mm_and_si128( v0, nibble ) ),
+				_mm_shuffle_epi8( hi1, _mm_and_si128( _mm_srli_epi16( v0, 4 ), nibble ) ) ),
+			_mm_and_si128( _mm_shuffle_epi8( lo2, _mm_and_si128( v1, nibble ) ),
+				_mm_shuffle_epi8( hi2, _mm_and_si128( _mm_srli_epi16( v1, 4 ), nibble ) ) ) );
+		mask = _mm_movemask_epi8( _mm_cmpeq_epi8( m, _mm_setzero_si128() ) ) ^ 0xffff;
+		while ( mask != 0 ) {
+			int bit = __builtin_ctz( mask );
+			if ( bm_search_multi_candidate( p + bit, end ) ) return p + bit;
+			mask &= mask - 1;
+		}
+	}
+	return bm_search_multi_skip_scalar( p, end );
+}
 
-	
-	bm_search_data.finish_of_adding_files = 0;
+__attribute__((target("avx2")))
+static const uint8_t* bm_search_multi_skip_avx2( const uint8_t* p, const uint8_t* end )
+{
+	__m256i lo1 = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i*)bm_search_multi_data.lo1 ) );
+	__m256i hi1 = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i*)bm_search_multi_data.hi1 ) );
+	__m256i lo2 = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i*)bm_search_multi_data.lo2 ) );
+	__m256i hi2 = _mm256_broadcastsi128_si256( _mm_loadu_si128( (const __m128i*)bm_search_multi_data.hi2 ) );
+	__m256i nibble = _mm256_set1_epi8( 0x0f );
+	__m256i v0, v1, m;
+	unsigned mask;
+
+	for ( ; end - p >= 33; p += 32 ) {
+		v0 = _mm256_loadu_si256( (const __m256i*)p );
+		v1 = _mm256_loadu_si256( (const __m256i*)( p + 1 ) );
+		m = _mm256_and_si256(
+			_mm256_and_si256( _mm256_shuffle_epi8( lo1, _mm256_and_si256( v0, nibble ) ),
+				_mm256_shuffle_epi8( hi1, _mm256_and_si256( _mm256_srli_epi16( v0, 4 ), nibble ) ) ),
+			_mm256_and_si256( _mm256_shuffle_epi8( lo2, _mm256_and_si256( v1, nibble ) ),
+				_mm256_shuffle_epi8( hi2, _mm256_and_si256( _mm256_srli_epi16( v1, 4 ), nibble ) ) ) );
+		mask = ~(unsigned)_mm256_movemask_epi8( _mm256_cmpeq_epi8( m, _mm256_setzero_si256() ) );
+		while ( mask != 0 ) {
+			int bit = __builtin_ctz( mask );
+			if ( bm_search_multi_candidate( p + bit, end ) ) return p + bit;
+			mask &= mask - 1;
+		}
+	}
+	return bm_search_multi_skip_scalar( p, end );
+}
+#endif
 
-	/* create work thread */
-	thread = malloc( sizeof( pthread_t ) * thread_worker_count );
-	thread_id = malloc( sizeof(int)*thread_worker_count );
+/* put the first two bytes of a needle, or its one, in the skip tables */
+static void bm_search_multi_skip_add( int c0, int c1 )
+{
+	int k, c;
+
+	k = 1 << ( c0 % MULTI_BUCKETS );
+	bm_search_multi_data.lo1[c0 & 15] |= k;
+	bm_search_multi_data.hi1[c0 >> 4] |= k;
+	if ( c1 < 0 ) {
+		// any byte can follow a needle of one byte
+		bm_search_multi_data.single[c0] = 1;
+		for ( c = 0; c < 16; ++c ) {
+			bm_search_multi_data.lo2[c] |= k;
+			bm_search_multi_data.hi2[c] |= k;
+		}
+		memset( bm_search_multi_data.pairs + c0 * ALPHABET_LEN / 8, 0xff, ALPHABET_LEN / 8 );
+	}
+	else {
+		bm_search_multi_data.lo2[c1 & 15] |= k;
+		bm_search_multi_data.hi2[c1 >> 4] |= k;
+		c = ( c0 << 8 ) | c1;
+		bm_search_multi_data.pairs[c >> 3] |= 1 << ( c & 7 );
+	}
+}
 
-	for ( i = 0; i < thread_worker_count; ++i ) {
-		thread_id[i] = i;
-		rv = pthread_create( &thread[i], NULL, bm_search_and_output_from_global_worker,  &thread_id[i] );
-		if ( rv != 0 ) {
-			return -1;
+/* compile the needles into the automaton and the skip tables; caseless
+   needles are in lower case, and their letters' upper case is given the
+   same classes and put in the skip tables too */
+static void bm_search_multi_build( char** needles, int count, int caseless )
+{
+	int* fail;
+	int* queue;
+	int state_count, states;
+	int i, j, k, c, s, t, head, tail;
+	uint8_t* n;
+
+	memset( bm_search_multi_data.cls, 0, sizeof( bm_search_multi_data.cls ) );
+	memset( bm_search_multi_data.pairs, 0, sizeof( bm_search_multi_data.pairs ) );
+	memset( bm_search_multi_data.single, 0, sizeof( bm_search_multi_data.single ) );
+	memset( bm_search_multi_data.lo1, 0, 16 );
+	memset( bm_search_multi_data.hi1, 0, 16 );
+	memset( bm_search_multi_data.lo2, 0, 16 );
+	memset( bm_search_multi_data.hi2, 0, 16 );
+
+	// a class for each byte used, and the skip tables
+	bm_search_multi_data.class_count = 1;
+	states = 1;
+	for ( i = 0; i < count; ++i ) {
+		n = (uint8_t*)needles[i];
+		for ( j = 0; j < bm_search_multi_data.lengths[i]; ++j ) {
+			if ( bm_search_multi_data.cls[n[j]] == 0 ) {
+				bm_search_multi_data.cls[n[j]] = bm_search_multi_data.class_count++;
+			}
+		}
+		states += bm_search_multi_data.lengths[i];
+
+		c = bm_search_multi_data.lengths[i] == 1 ? -1 : n[1];
+		bm_search_multi_skip_add( n[0], c );
+		if ( caseless ) {
+			bm_search_multi_skip_add( UNFOLD( n[0] ), c );
+			if ( c >= 0 ) {
+				bm_search_multi_skip_add( n[0], UNFOLD( c ) );
+				bm_search_multi_skip_add( UNFOLD( n[0] ), UNFOLD( c ) );
+			}
 		}
 	}
-	/* add files into global list */
-	for ( i = 0; i < file_count; ++i ) {
-		bm_search_worker_add_into_global( file_name_list[i] );
+	if ( caseless ) {
+		for ( c = 'a'; c <= 'z'; ++c ) {
+			bm_search_multi_data.cls[UNFOLD( c )] = bm_search_multi_data.cls[c];
+		}
 	}
 
-	/* set the flag that finish global list.*/
-	pthread_mutex_lock( &bm_search_data.global_worker_lock );
-	bm_search_data.finish_of_adding_files = 1;
-	pthread_cond_broadcast( &bm_search_data.global_worker_cond );
-	pthread_mutex_unlock( &bm_search_data.global_worker_lock );
+	// the trie of the needles
+	k = bm_search_multi_data.class_count;
+	bm_search_multi_data.delta = (int*)mymalloc( states * k * sizeof( int ) );
+	bm_search_multi_data.match = (int*)mymalloc( states * sizeof( int ) );
+	for ( i = 0; i < states * k; ++i ) {
+		bm_search_multi_data.delta[i] = -1;
+	}
+	for ( i = 0; i < states; ++i ) {
+		bm_search_multi_data.match[i] = -1;
+	}
+	state_count = 1;
+	for ( i = 0; i < count; ++i ) {
+		n = (uint8_t*)needles[i];
+		s = 0;
+		for ( j = 0; j < bm_search_multi_data.lengths[i]; ++j ) {
+			c = bm_search_multi_data.cls[n[j]];
+			if ( bm_search_multi_data.delta[s * k + c] < 0 ) {
+				bm_search_multi_data.delta[s * k + c] = state_count++;
+			}
+			s = bm_search_multi_data.delta[s * k + c];
+		}
+		if ( bm_search_multi_data.match[s] < 0 ) {
+			bm_search_multi_data.match[s] = i;
+		}
+	}
 
-	/* block until all threads finish. */
-	for ( i = 0; i < thread_worker_count; ++i ) {
-		pthread_join( thread[i], NULL );
+	// the failure links, breadth first, filling in the missing transitions
+	// from the state each fails to, which is nearer the start and done
+	fail = (int*)mymalloc( state_count * sizeof( int ) );
+	queue = (int*)mymalloc( state_count * sizeof( int ) );
+	head = tail = 0;
+	fail[0] = 0;
+	queue[tail++] = 0;
+	while ( head < tail ) {
+		s = queue[head++];
+		for ( c = 0; c < k; ++c ) {
+			t = bm_search_multi_data.delta[s * k + c];
+			if ( t < 0 ) {
+				bm_search_multi_data.delta[s * k + c] = 
+					s == 0 ? 0 : bm_search_multi_data.delta[fail[s] * k + c];
+				continue;
+			}
+			fail[t] = s == 0 ? 0 : bm_search_multi_data.delta[fail[s] * k + c];
+			if ( bm_search_multi_data.match[t] < 0 ) {
+				bm_search_multi_data.match[t] = bm_search_multi_data.match[fail[t]];
+			}
+			queue[tail++] = t;
+		}
 	}
+	free( fail );
+	free( queue );
+}
 
+/* search a file for the needles, and output the file name, the needle and
+   the line number and text of each line with one; returns -1 if the file
+   cannot be read */
+static int bm_search_multi_file( char* file, output_buffer_t* out )
+{
+	bm_search_read_t r;
+	const uint8_t* p, *end;
+	const uint8_t* cls = bm_search_multi_data.cls;
+	const int* delta = bm_search_multi_data.delta;
+	const int* match = bm_search_multi_data.match;
+	int k = bm_search_multi_data.class_count;
+	bm_search_state_t state;
+	char* label;
+	char* s;
+	size_t room;
+	int n, m, st;
+	int line_number = 1;
+
+	if ( bm_search_read_open( &r, file ) != 0 ) return -1;
+	while ( bm_search_read_next( &r ) ) {
+		// the blocks end at a newline, which no needle has, so each starts
+		// in the start state
+		bm_search_set( &state, NULL, NULL, r.text, r.len, NULL, 0 );
+		state.line_number = line_number;
+		state.base = r.base;
+		bm_search_use_lines( &state, file );
+		end = r.text + r.len;
+		p = r.text;
+		st = 0;
+		while ( p < end ) {
+			if ( st == 0 ) {
+				p = (*bm_search_multi_kernel)( p, end );
+				if ( p == end ) break;
+			}
+			st = delta[st * k + cls[*p++]];
+			m = match[st];
+			if ( m < 0 ) continue;
+
+			// the line has a needle: output it, and go on from the next line
+			bm_search_number_line( &state, (uint8_t*)p - bm_search_multi_data.lengths[m] );
+			label = bm_search_multi_data.labels[m];
+			room = strlen( file ) + strlen( label ) + OUTPUT_BUFFER_LINE;
+			s = bm_search_out_reserve( out, room );
+			n = snprintf( s, room, bm_search_multi_data.format, file, label, (long)state.line_number );
+			if ( n >= room ) {
+				s = bm_search_out_reserve( out, n + 1 );
+				snprintf( s, n + 1, bm_search_multi_data.format, file, label, (long)state.line_number );
+			}
+			out->len += n;
+			p = bm_search_out_line( out, r.text, r.len, (uint8_t*)p - 1 );
+			st = 0;
+		}
+		if ( !r.done ) {
+			line_number = state.line_number +
+				(*count_lines_kernel)( state.line_counted, r.text + r.len );
+		}
+	}
+	bm_search_read_close( &r );
 	return 0;
 }
 
+/* the text by which a needle is output, which must be one word */
+static char* bm_search_multi_label( char* needle )
+{
+	char* p;
+
+	for ( p = needle; *p != '\0'; ++p ) {
+		if ( *p == ' ' || !is_printable_char( (uint8_t)*p ) ) {
+			return "<text>";
+		}
+	}
+	return needle;
+}
+
+/* search the files for any of the needles in one pass over each, on the
+   pool, and output the lines with one in the order of the file list, each
+   with the file name, the needle and the line number in the format;
+   returns -1 if there are no needles */
+int bm_search_multi( char** file_name_list, int file_count, FILE* output, char* format,
+		char** needles, int needle_count, int caseless )
+{
+	int i, count;
+	char* n;
+
+	// the empty needles would match every line; the caseless ones are
+	// copied in lower case
+	bm_search_multi_data.needles = (char**)mymalloc( ( needle_count + 1 ) * sizeof( char* ) );
+	bm_search_multi_data.labels = (char**)mymalloc( ( needle_count + 1 ) * sizeof( char* ) );
+	bm_search_multi_data.lengths = (int*)mymalloc( ( needle_count + 1 ) * sizeof( int ) );
+	count = 0;
+	for ( i = 0; i < needle_count; ++i ) {
+		if ( *needles[i] != '\0' ) {
+			bm_search_multi_data.needles[count] = caseless ? my_strdup( needles[i] ) : needles[i];
+			for ( n = bm_search_multi_data.needles[count]; caseless && *n != '\0'; ++n ) {
+				*n = FOLD( (uint8_t)*n );
+			}
+			bm_search_multi_data.labels[count] = bm_search_multi_label( needles[i] );
+			bm_search_multi_data.lengths[count] = (int)strlen( needles[i] );
+			++count;
+		}
+	}
+	bm_search_multi_data.count = count;
+	if ( count > 0 ) {
+		pthread_once( &bm_search_kernel_once, bm_search_kernel_init );
+		bm_search_multi_build( bm_search_multi_data.needles, count, caseless );
+		bm_search_multi_data.format = format;
+		if ( file_count > 0 ) {
+			bm_search_ordered_run( file_name_list, file_count, output, bm_search_multi_file );
+		}
+		free( bm_search_multi_data.delta );
+		free( bm_search_multi_data.match );
+	}
+	for ( i = 0; caseless && i < count; ++i ) {
+		free( bm_search_multi_data.needles[i] );
+	}
+	free( bm_search_multi_data.needles );
+	free( bm_search_multi_data.labels );
+	free( bm_search_multi_data.lengths );
+	return count > 0 ? 0 : -1;
+}
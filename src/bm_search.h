@@ -1,36 +1,34 @@
 #include <stdio.h>
 
 typedef struct {
-	int id;
-} thread_info_t;
-
-typedef struct match_info_s {
-	char*  filename;
-	int    line_number;
-	size_t offset; 
-	struct match_info_s* next;
-} match_info_t;
-
-typedef struct file_info_s {
-	char* filename;
-	struct file_info_s* next;
-} file_info_t;
-
-typedef struct worker_info_s {
-	file_info_t*  file_list;
-	file_info_t*  file_last;
-	match_info_t* match_list;
-	match_info_t* match_last;
-} worker_info_t;
-
-extern worker_info_t* bm_search_info;
+	char*  text;
+	size_t len;
+	size_t size;
+} output_buffer_t;
+
+/* searches a file into an output buffer; returns -1 if it cannot be read */
+typedef int (*bm_search_file_fn)( char* file, output_buffer_t* out );
 
 int bm_search(char *file, FILE *output, char *format, char* pattern);
+size_t bm_search_count_lines( const char* from, const char* to );
+char*  bm_search_find( const char* text, size_t len, const char* pat, size_t pat_len,
+		int fold );
 
-int  bm_search_worker_init( FILE* output, char* fmt, char* pat, int file_count );
+int  bm_search_worker_init( FILE* output, char* fmt, char* pat, int caseless );
 void bm_search_worker_deinit( void );
-int  bm_search_worker_add( int index, char* file );
-int  bm_search_worker_run( void );
-int  bm_search_and_output_worker_run( void );
 
 int  bm_search_and_output_global_worker_run( char** file_name_list, int file_count );
+void bm_search_ordered_run( char** file_name_list, int file_count, FILE* output,
+		bm_search_file_fn search );
+int  bm_search_multi( char** file_name_list, int file_count, FILE* output, char* format,
+		char** needles, int needle_count, int caseless );
+
+void bm_search_out_head( output_buffer_t* out, char* format, char* file, long line_number );
+void bm_search_out_text( output_buffer_t* out, const char* text, size_t len );
+void bm_search_out_flush( output_buffer_t* out, FILE* output );
+void bm_search_out_free( output_buffer_t* out );
+
+void bm_search_read_report( char* msg, size_t size );
+
+/* in egrep.y */
+int  egrep( char* file, output_buffer_t* output, char* format );
@@ -42,12 +42,12 @@
 
 #include "library.h"
 #include "alloc.h"
+#include "cache.h"
+#include "postsort.h"
 #include "scanner.h"
 #include "version.h"		/* for FILEVERSION */
 #include "vp.h"
-#if defined( __MSDOS__ ) && defined( TCC )
-#include "sort.h"
-#endif
+#include <time.h>
 
 #if defined(USE_NCURSES) && !defined(RENAMED_NCURSES)
 #include <ncurses.h>
@@ -60,38 +60,86 @@
 BOOL	buildonly = NO;		/* only build the database */
 BOOL	unconditional = NO;	/* unconditionally build database */
 BOOL	fileschanged;		/* assume some files changed */
+char	*buildprefix;		/* build progressively, these files first */
 
 /* variable copies of the master strings... */
 char	invname_buf[] = INVNAME;
 char	invpost_buf[] = INVPOST;
 char	reffile_buf[] = REFFILE;
+char	cgname_buf[] = CGNAME;
+char	linename_buf[] = LINENAME;
 char	*invname = invname_buf;	/* inverted index to the database */
 char	*invpost = invpost_buf;	/* inverted index postings */
+char	*cgname = cgname_buf;	/* call graph index */
+char	*linename = linename_buf;	/* source line table */
 char	*reffile = reffile_buf;	/* cross-reference file path name */
 
 char	*newreffile;		/* new cross-reference file name */
-FILE	*newrefs;		/* new cross-reference */
-FILE	*postings;		/* new inverted index postings */
 int	symrefs = -1;		/* cross-reference file */
 
 INVCONTROL invcontrol;		/* inverted file control structure */
+CGCONTROL cgcontrol;		/* call graph index control structure */
+LINECONTROL linecontrol;	/* source line table control structure */
 
 
 /* Local variables: */
 static char *newinvname;	/* new inverted index file name */
 static char *newinvpost;	/* new inverted index postings file name */
+static char *newcgname;		/* new call graph index file name */
+static char *newlinename;	/* new source line table file name */
+static char *newckptname;	/* build checkpoint file name */
+static char *newpostname;	/* checkpointed postings file name */
+static char *postfile;		/* postings sort run name prefix */
+static char *lockname;		/* build lock file name */
+static int lockfd = -1;		/* build lock, if held */
+static BOOL lockwaited;		/* another process built the database */
+static BOOL lockheld;		/* build() is not to take or release it */
 static long traileroffset;	/* file trailer offset */
+static int ckptinterval;	/* seconds between build checkpoints */
+static time_t ckpttime;		/* time of the last checkpoint */
+
+#define	PROGFILES	1000	/* files in the first partial database */
+#define	LOCKWAIT	120	/* default seconds to wait for another build */
+
+/* the state of the file loop of build() at a checkpoint */
+typedef struct {
+    unsigned long fileindex;	/* next source file */
+    unsigned long firstfile;	/* first source file in pass */
+    unsigned long lastfile;	/* last source file in pass */
+    int     built;		/* built crossref for these files */
+    int     copied;		/* copied crossref for these files */
+    long    newoffset;		/* new database offset */
+    long    postruns;		/* postings sort runs */
+    long    npostings;		/* number of postings */
+    long    oldoffset;		/* old database offset, or -1 if at end */
+    char    oldfile[PATHLEN + 1]; /* file in old cross-reference */
+} CHECKPOINT;
+
+/* a source file in the order of a progressive build */
+typedef struct {
+    char    *name;		/* file name */
+    BOOL    first;		/* below the -B path */
+    time_t  mtime;		/* modification time */
+} PRIORITY;
 
 
 /* Internal prototypes: */
 static	void	cannotindex(void);
 static	int	compare(const void *s1, const void *s2);
+static	int	prioritycompare(const void *p1, const void *p2);
+static	BOOL	copycached(char *file, char *key);
 static	void	copydata(void);
 static	void	copyinverted(void);
 static	char	*getoldfile(void);
+static	void	indexfile(char *file);
+static	void	makelines(void);
 static	void	movefile(char *new, char *old);
 static	void	putheader(char *dir);
 static	void	fetch_include_from_dbase(char *, size_t);
+static	BOOL	lockbuild(void);
+static	void	unlockbuild(void);
+static	BOOL	getcheckpoint(char *dir, time_t reftime, CHECKPOINT *ck);
+static	void	putcheckpoint(char *dir, time_t reftime, CHECKPOINT *ck);
 static	void	putlist(char **names, int count);
 static	BOOL	samelist(FILE *oldrefs, char **names, int count);
 
@@ -155,7 +203,21 @@ void setup_build_filenames(char *reffile)
     newinvname = my_strdup(path);
     strcpy(s, mybasename(invpost));
     newinvpost = my_strdup(path);
+    strcpy(s, mybasename(cgname));
+    newcgname = my_strdup(path);
+    strcpy(s, mybasename(linename));
+    newlinename = my_strdup(path);
+    strcpy(s, mybasename(reffile));
+    strcat(s, ".ckpt");
+    newckptname = my_strdup(path);
+    strcpy(s, mybasename(reffile));
+    strcat(s, ".post");
+    newpostname = my_strdup(path);
     free(path);
+    path = mymalloc(strlen(reffile) + 10);
+    strcpy(path, reffile);
+    strcat(path, ".lock");
+    lockname = path;
 }
 
 /* open the database */
@@ -175,6 +237,20 @@ opendatabase(void)
 	askforreturn();		/* so user sees message */
 	invertedindex = NO;
     }
+    /* map any call graph index of this cross-reference; it is only used
+       for transitive queries */
+    if (invertedindex == YES) {
+	struct stat statstruct;
+
+	if (fstat(symrefs, &statstruct) == 0) {
+	    (void) cgopen(&cgcontrol, cgname, (long) statstruct.st_size);
+	}
+    }
+    if (calldepth != 1 && cgcontrol.header == NULL) {
+	posterr("cscope: no call graph index, -G option ignored");
+    }
+    /* map any source line table for the text searches */
+    (void) lineopen(&linecontrol, linename);
 }
 
 
@@ -183,6 +259,8 @@ void
 rebuild(void)
 {
     close(symrefs);
+    cgclose(&cgcontrol);
+    lineclose(&linecontrol);
     if (invertedindex == YES) {
 	invclose(&invcontrol);
 	nsrcoffset = 0;
@@ -219,6 +297,7 @@ build(void)
     int     copied = 0;		/* copied crossref for these files */
     unsigned long fileindex;		/* source file name index */
     BOOL    interactive = YES;	/* output progress messages */
+    CHECKPOINT ck;		/* file loop state at a checkpoint */
 
     /* normalize the current directory relative to the home directory so
        the cross-reference is not rebuilt when the user's login is moved */
@@ -230,11 +309,17 @@ build(void)
     }
     /* sort the source file names (needed for rebuilding) */
     qsort(srcfiles, nsrcfiles, sizeof(char *), compare);
+    ptrenumber(&srctrie, srcfiles, nsrcfiles);
 
+    /* only one process builds the database at a time; the others use
+       the one it publishes */
+    if (lockheld == NO && lockbuild() == NO) {
+	return;
+    }
     /* if there is an old cross-reference and its current directory matches */
     /* or this is an unconditional build */
     if ((oldrefs = vpfopen(reffile, "rb")) != NULL
-	&& unconditional == NO
+	&& (unconditional == NO || lockwaited == YES)
 	&& fscanf(oldrefs, "cscope %d %" PATHLEN_STR "s", &fileversion, olddir) == 2 
 	&& (strcmp(olddir, currentdir) == 0 /* remain compatible */
 	    || strcmp(olddir, newdir) == 0)) {
@@ -245,6 +330,7 @@ build(void)
 	    BOOL	oldcompress = YES;
 	    BOOL	oldinvertedindex = NO;
 	    BOOL	oldtruncate = NO;
+	    BOOL	oldpartial = NO;
 	    int	c;
 
 	    /* see if there are options in the database */
@@ -266,6 +352,9 @@ build(void)
 		case 'T':	/* truncate symbols to 8 characters */
 		    oldtruncate = YES;
 		    break;
+		case 'P':	/* only some of the files */
+		    oldpartial = YES;
+		    break;
 		}
 	    }
 	    /* check the old and new option settings */
@@ -282,6 +371,7 @@ cscope: -q option mismatch between command line and old symbol database\n");
 			    invname, invpost);
 		    unlink(invname);
 		    unlink(invpost);
+		    unlink(cgname);
 		}
 		goto outofdate;
 	    }
@@ -291,6 +381,11 @@ cscope: -q option mismatch between command line and old symbol database\n");
 		posterr("cscope: incorrect symbol database file format\n");
 		goto force;
 	    }
+	    /* copy the files of a partial database, but never use it as
+	       it is */
+	    if (oldpartial == YES) {
+		goto outofdate;
+	    }
 	}
 	/* if assuming that some files have changed */
 	if (fileschanged == YES) {
@@ -322,6 +417,9 @@ cscope: -q option mismatch between command line and old symbol database\n");
 	    addsrcfile(oldname);
 	}
 	fclose(oldrefs);
+	if (lockheld == NO) {
+	    unlockbuild();
+	}
 	return;
 		
     outofdate:
@@ -346,32 +444,65 @@ cscope: converting to new symbol database file format\n");
 	reftime = 0;
 	oldfile = NULL;
     }
-    /* open the new cross-reference file */
-    if ((newrefs = myfopen(newreffile, "wb")) == NULL) {
-	postfatal("cscope: cannot open file %s\n", reffile);
-	/* NOTREACHED */
+    /* checkpoint the build periodically if requested, with the postings
+       next to the new database so they are not removed on an interrupt;
+       otherwise they are in the temporary directory */
+    ckptinterval = atoi(mygetenv("CSCOPE_CHECKPOINT", "0"));
+    if (ckptinterval < 0) {
+	ckptinterval = 0;
     }
-    if (invertedindex == YES && (postings = myfopen(temp1, "wb")) == NULL) {
-	cannotwrite(temp1);
-	cannotindex();
+    postfile = (ckptinterval > 0) ? newpostname : temp1;
+    ckpttime = time(NULL);
+    if (invertedindex == YES) {
+	postopen(postfile, ckptinterval > 0);
+    }
+
+    /* continue an interrupted build of the same files */
+    if (ckptinterval > 0 && getcheckpoint(newdir, reftime, &ck) == YES) {
+	fileindex = ck.fileindex;
+	firstfile = ck.firstfile;
+	lastfile = ck.lastfile;
+	built = ck.built;
+	copied = ck.copied;
+	if (ck.oldoffset < 0) {
+	    oldfile = NULL;
+	} else {
+	    blocknumber = -1;
+	    dbseek(ck.oldoffset);
+	    oldfile = ck.oldfile;
+	}
+	fileversion = FILEVERSION;
+	if (linemode == NO || verbosemode == YES) {
+	    postmsg("Resuming interrupted build...");
+	}
+    } else {
+	unlink(newckptname);
+
+	/* open the new cross-reference file */
+	if (dbcreate(newreffile) == NO) {
+	    postfatal("cscope: cannot open file %s\n", reffile);
+	    /* NOTREACHED */
+	}
+	putheader(newdir);
+	fileversion = FILEVERSION;
+
+	/* output the leading tab expected by crossref() */
+	dbputc('\t');
+
+	/* make passes through the source file list until the last level
+	   of included files is processed */
+	fileindex = firstfile = 0;
+	lastfile = nsrcfiles;
+	if (invertedindex == YES) {
+	    srcoffset = mymalloc((nsrcfiles + 1) * sizeof(long));
+	}
     }
-    putheader(newdir);
-    fileversion = FILEVERSION;
     if (buildonly == YES && verbosemode != YES && !isatty(0)) {
 	interactive = NO;
     } else {
 	searchcount = 0;
     }
-    /* output the leading tab expected by crossref() */
-    dbputc('\t');
-
-    /* make passes through the source file list until the last level of
-       included files is processed */
-    firstfile = 0;
-    lastfile = nsrcfiles;
-    if (invertedindex == YES) {
-	srcoffset = mymalloc((nsrcfiles + 1) * sizeof(long));
-    }
+    cacheinit();
     for (;;) {
 	progress("Building symbol database", (long)built,
 		 (long)lastfile);
@@ -379,12 +510,28 @@ cscope: converting to new symbol database file format\n");
 	    refresh();
 
 	/* get the next source file name */
-	for (fileindex = firstfile; fileindex < lastfile; ++fileindex) {
+	for (; fileindex < lastfile; ++fileindex) {
 			
 	    /* display the progress about every three seconds */
 	    if (interactive == YES && fileindex % 10 == 0) {
 		progress("Building symbol database", fileindex, lastfile);
 	    }
+	    /* save the state to resume from if interrupted */
+	    if (ckptinterval > 0 && time(NULL) - ckpttime >= ckptinterval) {
+		ck.fileindex = fileindex;
+		ck.firstfile = firstfile;
+		ck.lastfile = lastfile;
+		ck.built = built;
+		ck.copied = copied;
+		if (oldfile == NULL) {
+		    ck.oldoffset = -1;
+		    ck.oldfile[0] = '\0';
+		} else {
+		    ck.oldoffset = blocknumber * BUFSIZ + (blockp - block);
+		    snprintf(ck.oldfile, sizeof(ck.oldfile), "%s", oldfile);
+		}
+		putcheckpoint(newdir, reftime, &ck);
+	    }
 	    /* if the old file has been deleted get the next one */
 	    file = srcfiles[fileindex];
 	    while (oldfile != NULL && strcmp(file, oldfile) > 0) {
@@ -392,12 +539,12 @@ cscope: converting to new symbol database file format\n");
 	    }
 	    /* if there isn't an old database or this is a new file */
 	    if (oldfile == NULL || strcmp(file, oldfile) < 0) {
-		crossref(file);
+		indexfile(file);
 		++built;
 	    } else if (lstat(file, &statstruct) == 0
 		       && statstruct.st_mtime > reftime) {
 		/* if this file was modified */
-		crossref(file);
+		indexfile(file);
 		++built;
 				
 		/* skip its old crossref so modifying the last source
@@ -422,7 +569,7 @@ cscope: converting to new symbol database file format\n");
 	if (lastfile == nsrcfiles) {
 	    break;
 	}
-	firstfile = lastfile;
+	fileindex = firstfile = lastfile;
 	lastfile = nsrcfiles;
 	if (invertedindex == YES) {
 	    srcoffset = myrealloc(srcoffset,
@@ -431,7 +578,9 @@ cscope: converting to new symbol database file format\n");
 	/* sort the included file names */
 	qsort(&srcfiles[firstfile], (lastfile - firstfile), 
 	      sizeof(char *), compare);
+	ptrenumber(&srctrie, srcfiles, nsrcfiles);
     }
+
     /* add a null file name to the trailing tab */
     putfilename("");
     dbputc('\n');
@@ -443,72 +592,231 @@ cscope: converting to new symbol database file format\n");
     putlist(srcdirs, nsrcdirs);
     putlist(incdirs, nincdirs);
     putlist(srcfiles, nsrcfiles);
-    if (fflush(newrefs) == EOF) {
-	/* rewind doesn't check for write failure */
-	cannotwrite(newreffile);
-	/* NOTREACHED */
-    }
+    dbflush();
 
-    /* create the inverted index if requested */
-	if (invertedindex == YES) {
-		char	sortcommand[PATHLEN + 1];
-		char	sorttempfile[PATHLEN + 1];
-
-		if (fflush(postings) == EOF) {
-			cannotwrite(temp1);
-			/* NOTREACHED */
-		}
-		fstat(fileno(postings), &statstruct);
-		fclose(postings);
-#if defined(__MSDOS__) && defined(TCC)
-		//snprintf(sortcommand, sizeof(sortcommand), "set LC_ALL=C & gnusort -T %s %s", tmpdir, temp1);
-
-		char * files[1];
-		files[0] = temp1;
-		snprintf(sorttempfile, sizeof(sorttempfile), "%s.sort", temp1);
-		printf("%s\n", sorttempfile);
-		sort(files, 1, sorttempfile);
-
-		postings = fopen( sorttempfile, "r" );
-		if ( postings == NULL ) {
-			fprintf(stderr, "cscope: cannot open sorted temp file\n");
-			cannotindex();
-		} else {
-#else
-		snprintf(sortcommand, sizeof(sortcommand), "env LC_ALL=C sort -T %s %s", tmpdir, temp1);
-		if ((postings = mypopen(sortcommand, "r")) == NULL) {
-			fprintf(stderr, "cscope: cannot open pipe to sort command\n");
-			cannotindex();
-		} else {
-#endif
-			if ((totalterms = invmake(newinvname, newinvpost, postings)) > 0) {
-				movefile(newinvname, invname);
-				movefile(newinvpost, invpost);
-			} else {
-				cannotindex();
-			}
-			mypclose(postings);
-		}
-		unlink(temp1);
-		free(srcoffset);
+    /* create the inverted index if requested, from the postings sorted
+       while the files were cross-referenced */
+    if (invertedindex == YES) {
+	if ((totalterms = postmake(newinvname, newinvpost)) > 0) {
+	    movefile(newinvname, invname);
+	    movefile(newinvpost, invpost);
+	} else {
+	    cannotindex();
 	}
+	postclose(NO);
+	free(srcoffset);
+    }
     /* rewrite the header with the trailer offset and final option list */
-    rewind(newrefs);
+    dbrewrite(0L);
     putheader(newdir);
-    fclose(newrefs);
+    dbclose();
+
+    /* put the files that were not in the fragment cache into it */
+    cachefinish();
 	
     /* close the old database file */
     if (symrefs >= 0) {
 	close(symrefs);
+	symrefs = -1;
     }
     if (oldrefs != NULL) {
 	fclose(oldrefs);
     }
+    /* create the call graph index from the new cross-reference */
+    if (invertedindex == YES) {
+	if ((symrefs = vpopen(newreffile, O_BINARY | O_RDONLY)) == -1 ||
+	    cgmake(newcgname) < 0) {
+	    fprintf(stderr, "cscope: cannot create call graph index\n");
+	    unlink(newcgname);
+	    unlink(cgname);	/* the old one is of the old database */
+	} else {
+	    movefile(newcgname, cgname);
+	}
+	if (symrefs >= 0) {
+	    close(symrefs);
+	    symrefs = -1;
+	}
+    }
+    /* make the source line table from the lines counted as the files
+       were cross-referenced, and those of the files copied */
+    makelines();
+
     /* replace it with the new database file */
+    unlink(newckptname);
     movefile(newreffile, reffile);
+    if (lockheld == NO) {
+	unlockbuild();
+    }
+}
+
+
+/* make the source line table, copying the lines of the unchanged files
+   from the old one */
+static void
+makelines(void)
+{
+    LINECONTROL old;
+    long    made;
+
+    (void) lineopen(&old, linename);
+    made = linemake(newlinename, &old, srcfiles, nsrcfiles);
+    lineclose(&old);
+    if (made >= 0) {
+	movefile(newlinename, linename);
+    }
 }
 	
 
+/* take the lock for building the database, waiting for any other process
+   building it; returns NO if there is an old database to use instead
+   after waiting CSCOPE_LOCKWAIT seconds */
+static BOOL
+lockbuild(void)
+{
+    int     wait;		/* seconds to wait */
+    int     waited;
+
+    wait = atoi(mygetenv("CSCOPE_LOCKWAIT", "-1"));
+    if (wait < 0) {
+	wait = LOCKWAIT;
+    }
+    lockwaited = NO;
+    for (waited = 0; ; ++waited) {
+	/* build without the lock if it cannot be made */
+	if ((lockfd = os_lock_file(lockname)) != -1) {
+	    return(YES);
+	}
+	if (waited == 0 && (linemode == NO || verbosemode == YES)) {
+	    postmsg("Waiting for another cscope to build the database...");
+	}
+	if (waited >= wait && access(reffile, READ) == 0) {
+	    posterr("\
+cscope: database is still being built by another process, using the old one\n");
+	    return(NO);
+	}
+	lockwaited = YES;
+#if defined(__MSDOS__) && defined(TCC)
+	(void) Sleep(1000);
+#else
+	(void) sleep(1);
+#endif
+    }
+}
+
+
+/* release the lock for building the database */
+static void
+unlockbuild(void)
+{
+    os_unlock_file(lockfd);
+    lockfd = -1;
+}
+
+
+/* build the database progressively: the source files are cross-referenced
+   in priority order, and a database of the files done so far, marked as
+   partial, is published after the first PROGFILES files and whenever their
+   number doubles.  Each one is the old database the next one copies them
+   from, so only the new files are read, and the copying adds at most about
+   as much work again as the final build.  The build lock is held from the
+   first one to the last, so no other process builds in between */
+void
+progressbuild(void)
+{
+    PRIORITY *order;		/* source files in priority order */
+    unsigned long nfiles;	/* number of source files */
+    unsigned long done;		/* number of files in the database */
+    unsigned long i;
+    BOOL    force;		/* -u option */
+    char    prefix[PATHLEN + 1]; /* -B path */
+    char    msg[MSGLEN + 1];
+    long    first, last;	/* range of the files below the path */
+    struct  stat statstruct;
+
+    /* order the files below the path first, then the most recently
+       modified; sorted, the files below a path are a range of them */
+    qsort(srcfiles, nsrcfiles, sizeof(char *), compare);
+    ptrenumber(&srctrie, srcfiles, nsrcfiles);
+    snprintf(prefix, sizeof(prefix), "%s", buildprefix);
+    compath(prefix);
+    first = last = -1;
+    if (strcmp(prefix, ".") != 0) {	/* not all relative paths */
+	(void) ptrange(&srctrie, prefix, &first, &last);
+    }
+    nfiles = nsrcfiles;
+    order = mymalloc(nfiles * sizeof(PRIORITY));
+    for (i = 0; i < nfiles; ++i) {
+	order[i].name = my_strdup(srcfiles[i]);
+	if (strcmp(prefix, ".") == 0) {
+	    order[i].first = (*srcfiles[i] != '/');
+	} else {
+	    order[i].first = (long) i >= first && (long) i <= last;
+	}
+	order[i].mtime = 0;
+	if (lstat(srcfiles[i], &statstruct) == 0) {
+	    order[i].mtime = statstruct.st_mtime;
+	}
+    }
+    qsort(order, nfiles, sizeof(PRIORITY), prioritycompare);
+
+    if (lockbuild() == NO) {
+	goto freeorder;
+    }
+    lockheld = YES;
+    force = unconditional;
+    /* if another process just built the database, only bring it up to
+       date */
+    for (done = (lockwaited == YES) ? nfiles : PROGFILES; ; done *= 2) {
+	if (done > nfiles) {
+	    done = nfiles;
+	}
+	/* make the source file list the files to do so far */
+	freefilelist();
+	for (i = 0; i < done; ++i) {
+	    addsrcfile(order[i].name);
+	}
+	partialdb = (done < nfiles) ? YES : NO;
+	build();
+	if (done == nfiles) {
+	    break;
+	}
+	if (linemode == NO || verbosemode == YES) {
+	    snprintf(msg, sizeof(msg),
+		     "Published partial database of %lu of %lu files",
+		     done, nfiles);
+	    postmsg(msg);
+	}
+	/* only the first one can be unconditional */
+	unconditional = NO;
+    }
+    unconditional = force;
+    lockheld = NO;
+    unlockbuild();
+freeorder:
+    for (i = 0; i < nfiles; ++i) {
+	free(order[i].name);
+    }
+    free(order);
+}
+
+
+/* priority comparison function for qsort */
+static int
+prioritycompare(const void *arg_p1, const void *arg_p2)
+{
+    const PRIORITY *p1 = arg_p1;
+    const PRIORITY *p2 = arg_p2;
+
+    if (p1->first != p2->first) {
+	return(p1->first == YES ? -1 : 1);
+    }
+    if (p1->mtime != p2->mtime) {
+	return(p1->mtime > p2->mtime ? -1 : 1);
+    }
+    return(strcmp(p1->name, p2->name));
+}
+
+
 /* string comparison function for qsort */
 static int
 compare(const void *arg_s1, const void *arg_s2)
@@ -557,11 +865,255 @@ getoldfile(void)
 }
 
 
+/* output the cross-reference of a source file, from the fragment cache if
+   it is there */
+static void
+indexfile(char *file)
+{
+    char    key[CACHEKEYLEN + 1];	/* fragment cache key */
+    long    start;			/* file's database offset */
+
+    if (cachekey(file, key) == NO) {
+	crossref(file);
+	return;
+    }
+    if (copycached(file, key) == YES) {
+	return;
+    }
+    start = dboffset;
+    crossref(file);
+    if (dboffset > start) {	/* not if the file could not be read */
+	cachestore(key, start, dboffset);
+    }
+}
+
+
+/* copy a file's cross-reference from its cached fragment */
+static BOOL
+copycached(char *file, char *key)
+{
+    char    saveblock[BUFSIZ + 2];	/* old cross-reference block */
+    char    *saveblockp;
+    long    saveblocknumber;
+    int     saveblocklen;
+    char    saveblockmark;
+    int     saverefs;
+    char    header[PATLEN + 1];
+    int     fd;
+
+    if ((fd = cacheopen(key)) == -1) {
+	return(NO);
+    }
+    /* read the fragment in place of the old cross-reference, which is
+       put back where it was after */
+    memcpy(saveblock, block, sizeof(saveblock));
+    saveblockp = blockp;
+    saveblocknumber = blocknumber;
+    saveblocklen = blocklen;
+    saveblockmark = blockmark;
+    saverefs = symrefs;
+    symrefs = fd;
+    blocknumber = -1;
+    read_block();
+    fetch_string_from_dbase(header, sizeof(header));	/* skip the header */
+
+    putfilename(file);
+    if (invertedindex == YES) {
+	copyinverted();
+    } else {
+	copydata();
+    }
+    close(fd);
+    symrefs = saverefs;
+    memcpy(block, saveblock, sizeof(saveblock));
+    blockp = saveblockp;
+    blocknumber = saveblocknumber;
+    blocklen = saveblocklen;
+    blockmark = saveblockmark;
+    return(YES);
+}
+
+
+/* save the state of the build so far in the checkpoint file, for resuming
+   it if it is interrupted */
+static void
+putcheckpoint(char *dir, time_t reftime, CHECKPOINT *ck)
+{
+    char    temp[PATHLEN + 1];	/* new checkpoint file name */
+    FILE    *f;
+    unsigned long i;
+    int     j;
+
+    ckpttime = time(NULL);
+
+    /* the data must be on the disk before a checkpoint refers to it */
+    if (dbsync() == NO) {
+	return;
+    }
+    ck->newoffset = dboffset;
+    ck->npostings = npostings;
+    ck->postruns = 0;
+    if (invertedindex == YES && (ck->postruns = postsync()) < 0) {
+	return;
+    }
+    /* write it under a temporary name so the last one is kept if this
+       one is interrupted */
+    snprintf(temp, sizeof(temp), "%s.tmp", newckptname);
+    if ((f = myfopen(temp, "wb")) == NULL) {
+	return;
+    }
+    fprintf(f, "cscope checkpoint %d %s\n", FILEVERSION, dir);
+    fprintf(f, "%d %d %d %ld\n", compress, invertedindex, trun_syms,
+	    (long) reftime);
+    fprintf(f, "%lu %lu %lu %d %d\n", ck->fileindex, ck->firstfile,
+	    ck->lastfile, ck->built, ck->copied);
+    fprintf(f, "%ld %ld %ld %ld\n", ck->newoffset, ck->postruns,
+	    ck->npostings, ck->oldoffset);
+    fprintf(f, "%s\n", ck->oldfile);
+
+    /* the source files, including the #included files found so far */
+    fprintf(f, "%lu\n", nsrcfiles);
+    for (i = 0; i < nsrcfiles; ++i) {
+	fprintf(f, "%s\n", srcfiles[i]);
+    }
+    fprintf(f, "%d\n", nsrcoffset);
+    for (j = 0; j < nsrcoffset; ++j) {
+	fprintf(f, "%ld\n", srcoffset[j]);
+    }
+    fputs("end\n", f);
+    if (fflush(f) == EOF || os_sync(fileno(f)) != 0) {
+	fclose(f);
+	unlink(temp);
+	return;
+    }
+    fclose(f);
+    unlink(newckptname);
+    if (rename(temp, newckptname) == -1) {
+	unlink(temp);
+    }
+}
+
+
+/* restore the state of an interrupted build of the same source files from
+   its checkpoint file, and open its new database and postings runs to
+   continue them */
+static BOOL
+getcheckpoint(char *dir, time_t reftime, CHECKPOINT *ck)
+{
+    char    header[PATHLEN + 40];	/* expected first line */
+    char    line[PATHLEN + 40];
+    char    **names = NULL;		/* source files at the checkpoint */
+    long    *offsets = NULL;		/* their database offsets */
+    unsigned long nnames = 0, i;
+    int     noffsets = 0, j;
+    int     oldcompress, oldinverted, oldtruncate;
+    long    oldreftime;
+    time_t  savetime;			/* checkpoint time */
+    struct  stat statstruct;
+    FILE    *f;
+    BOOL    ok = NO;
+
+    if ((f = myfopen(newckptname, "rb")) == NULL) {
+	return(NO);
+    }
+    fstat(fileno(f), &statstruct);
+    savetime = statstruct.st_mtime;
+
+    /* it must be for the same database options and old database */
+    snprintf(header, sizeof(header), "cscope checkpoint %d %s\n",
+	     FILEVERSION, dir);
+    if (fgets(line, sizeof(line), f) == NULL || strcmp(line, header) != 0
+	|| fscanf(f, "%d %d %d %ld", &oldcompress, &oldinverted,
+		  &oldtruncate, &oldreftime) != 4
+	|| oldcompress != compress || oldinverted != invertedindex
+	|| oldtruncate != trun_syms || oldreftime != (long) reftime
+	|| fscanf(f, "%lu %lu %lu %d %d", &ck->fileindex, &ck->firstfile,
+		  &ck->lastfile, &ck->built, &ck->copied) != 5
+	|| fscanf(f, "%ld %ld %ld %ld", &ck->newoffset, &ck->postruns,
+		  &ck->npostings, &ck->oldoffset) != 4
+	|| getc(f) != '\n'
+	|| fgets(ck->oldfile, sizeof(ck->oldfile), f) == NULL
+	|| fscanf(f, "%lu", &nnames) != 1 || getc(f) != '\n'
+	|| nnames < nsrcfiles || ck->lastfile > nnames
+	|| ck->fileindex < ck->firstfile || ck->fileindex > ck->lastfile) {
+	goto done;
+    }
+    ck->oldfile[strcspn(ck->oldfile, "\n")] = '\0';
+
+    /* the source files must be the same, and the ones done unchanged */
+    names = mycalloc(nnames, sizeof(char *));
+    for (i = 0; i < nnames; ++i) {
+	if (fgets(line, sizeof(line), f) == NULL) {
+	    goto done;
+	}
+	line[strcspn(line, "\n")] = '\0';
+	if (i < nsrcfiles ? strcmp(line, srcfiles[i]) != 0
+			  : infilelist(line) == YES) {
+	    goto done;
+	}
+	if (i < ck->fileindex && lstat(line, &statstruct) == 0
+	    && statstruct.st_mtime > savetime) {
+	    goto done;
+	}
+	names[i] = my_strdup(line);
+    }
+    if (fscanf(f, "%d", &noffsets) != 1 || noffsets < 0
+	|| (unsigned long) noffsets > nnames + 1) {
+	goto done;
+    }
+    offsets = mymalloc((noffsets + 1) * sizeof(long));
+    for (j = 0; j < noffsets; ++j) {
+	if (fscanf(f, "%ld", &offsets[j]) != 1) {
+	    goto done;
+	}
+    }
+    if (fscanf(f, "%4s", line) != 1 || strcmp(line, "end") != 0) {
+	goto done;
+    }
+    /* reopen the new database and postings where the checkpoint was */
+    if ((invertedindex == YES && postresume(ck->postruns) == NO)
+	|| dbreopen(newreffile, ck->newoffset) == NO) {
+	goto done;
+    }
+    /* restore the #included files found, in the same order */
+    for (i = nsrcfiles; i < nnames; ++i) {
+	addsrcfile(names[i]);
+    }
+    ptrenumber(&srctrie, srcfiles, nsrcfiles);
+    if (invertedindex == YES) {
+	srcoffset = mymalloc((nsrcfiles + 1) * sizeof(long));
+	memcpy(srcoffset, offsets, noffsets * sizeof(long));
+	nsrcoffset = noffsets;
+    }
+    npostings = ck->npostings;
+    ok = YES;
+
+done:
+    fclose(f);
+    if (names != NULL) {
+	for (i = 0; i < nnames; ++i) {
+	    free(names[i]);
+	}
+	free(names);
+    }
+    free(offsets);
+    if (ok == NO) {
+	unlink(newckptname);
+    }
+    return(ok);
+}
+
+
 /* Free all storage allocated for filenames: */
 void free_newbuildfiles(void)
 {
     free(newinvname);
     free(newinvpost);
+    free(newcgname);
+    free(newlinename);
+    free(newckptname);
+    free(newpostname);
+    free(lockname);
     free(newreffile);
 }	
 
@@ -571,26 +1123,26 @@ void free_newbuildfiles(void)
 static void
 putheader(char *dir)
 {
-    dboffset = fprintf(newrefs, "cscope %d %s", FILEVERSION, dir);
+    dbprintf("cscope %d %s", FILEVERSION, dir);
     if (compress == NO) {
-	dboffset += fprintf(newrefs, " -c");
+	dbputs(" -c");
     }
     if (invertedindex == YES) {
-	dboffset += fprintf(newrefs, " -q %.10ld", totalterms);
+	dbprintf(" -q %.10ld", totalterms);
     } else {	
 	/* leave space so if the header is overwritten without -q
 	 * because writing the inverted index failed, the header
 	 * is the same length */
-	dboffset += fprintf(newrefs, "              ");
+	dbputs("              ");
     }
     if (trun_syms == YES) {
-	dboffset += fprintf(newrefs, " -T");
+	dbputs(" -T");
+    }
+    if (partialdb == YES) {
+	dbputs(" -P");
     }
 
-    dboffset += fprintf(newrefs, " %.10ld\n", traileroffset);
-#ifdef PRINTF_RETVAL_BROKEN
-    dboffset = ftell(newrefs); 
-#endif
+    dbprintf(" %.10ld\n", traileroffset);
 }
 
 
@@ -600,21 +1152,18 @@ putlist(char **names, int count)
 {
     int	i, size = 0;
 	
-    fprintf(newrefs, "%d\n", count);
+    dbprintf("%d\n", count);
     if (names == srcfiles) {
 
 	/* calculate the string space needed */
 	for (i = 0; i < count; ++i) {
 	    size += strlen(names[i]) + 1;
 	}
-	fprintf(newrefs, "%d\n", size);
+	dbprintf("%d\n", size);
     }
     for (i = 0; i < count; ++i) {
-	if (fputs(names[i], newrefs) == EOF ||
-	    putc('\n', newrefs) == EOF) {
-	    cannotwrite(newreffile);
-	    /* NOTREACHED */
-	}
+	dbputs(names[i]);
+	dbputc('\n');
     }
 }
 
@@ -722,7 +1271,7 @@ copyinverted(void)
 	    fetch_string_from_dbase(symbol, sizeof(symbol));
 	    type = ' ';
 	output:
-	    putposting(symbol, type);
+	    putposting(symbol, type, type != INCLUDE && peekassignment());
 	    writestring(symbol);
 	    if (blockp == NULL) {
 		return;
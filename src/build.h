@@ -38,34 +38,37 @@
 
 #include "global.h"		/* FIXME: temp. only */
 #include "invlib.h"
+#include "callgraph.h"
+#include "linetab.h"
+#include "dbwrite.h"
 
 /* types and macros of build.c to be used by other modules */
 
-/* database output macros that update its offset */
-#define	dbputc(c)	(++dboffset, (void) putc(c, newrefs))
-#define	dbfputs(s)	(dboffset += strlen(s), fputs(s, newrefs))
-
 /* declarations for globals defined in build.c */
 
 extern	BOOL	buildonly;	/* only build the database */
 extern	BOOL	unconditional;	/* unconditionally build database */
 extern	BOOL	fileschanged;	/* assume some files changed */
+extern	char	*buildprefix;	/* build progressively, these files first */
 
 extern	char	*reffile;	/* cross-reference file path name */
 extern	char	*invname; 	/* inverted index to the database */
 extern	char	*invpost;	/* inverted index postings */
+extern	char	*cgname;	/* call graph index */
+extern	char	*linename;	/* source line table */
 extern	char	*newreffile;	/* new cross-reference file name */
-extern	FILE	*newrefs;	/* new cross-reference */
-extern	FILE	*postings;	/* new inverted index postings */
 extern	int	symrefs;	/* cross-reference file */
 
 extern	INVCONTROL invcontrol;	/* inverted file control structure */
+extern	CGCONTROL cgcontrol;	/* call graph index control structure */
+extern	LINECONTROL linecontrol;	/* source line table control structure */
 
 /* Prototypes of external functions defined by build.c */
 
 void	build(void);
 void	free_newbuildfiles(void);
 void	opendatabase(void);
+void	progressbuild(void);
 void	rebuild(void);
 void	setup_build_filenames(char *reffile);
 void 	seek_to_trailer(FILE *f);
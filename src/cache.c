@@ -0,0 +1,372 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	crossref fragment cache
+ *
+ *	The cross-reference data of a source file depends only on its text,
+ *	its name suffix and the -c and -T options, so it is kept in a cache
+ *	directory, which can be shared by the databases of several checkouts,
+ *	in a fragment named by a hash of them.  A fragment has a header in
+ *	place of the file name, the file's data as it follows its name in the
+ *	database, and the mark of the next file, so build() can copy it like
+ *	an unchanged file's data from the old database.  Nothing in the data
+ *	depends on where it is in the database; the postings are output with
+ *	their new offsets while it is copied.  The fragments of the files
+ *	that were not found are written in one pass over the new database
+ *	when it is complete, so the writing of it is never waited for.
+ *
+ *	The cache is used if the CSCOPE_CACHEDIR environment variable names a
+ *	directory.  When the fragments in it are larger than CSCOPE_CACHESIZE
+ *	megabytes, the least recently used ones are removed at the end of the
+ *	build.
+ */
+
+#include "global.h"
+
+#include "alloc.h"
+#include "build.h"
+#include "cache.h"
+#include "library.h"
+#include "scanner.h"		/* for NEWFILE */
+#include "version.h"		/* for FILEVERSION */
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <utime.h>
+
+#define	FRAGSUFFIX	".frag"	/* fragment file name suffix */
+#define	TEMPAGE		3600	/* seconds after which a temporary is stale */
+
+unsigned long cachehits;	/* fragments found in the cache */
+unsigned long cachemisses;	/* fragments not found */
+
+typedef	struct {
+	char	*name;		/* fragment file name */
+	long	size;		/* its size */
+	time_t	used;		/* last use */
+} FRAGMENT;
+
+typedef	struct {
+	char	key[CACHEKEYLEN + 1];	/* fragment key */
+	long	start;		/* database offsets of the file's data */
+	long	end;
+} MISS;
+
+static	char	*cachedir;	/* cache directory, or NULL if not used */
+static	MISS	*misses;	/* fragments to write */
+static	long	nmisses, mmisses;
+static	unsigned long hash1, hash2;	/* content hashes */
+
+static	void	cachepath(char *key, char *path, int size);
+static	void	cachewrite(FILE *newdata, MISS *miss);
+static	void	cachetrim(long limit);
+static	void	hashbytes(char *s, long n);
+static	int	usedcompare(const void *f1, const void *f2);
+
+/* see if the cache is to be used, and reset its counters */
+
+BOOL
+cacheinit(void)
+{
+	struct	stat	statstruct;
+
+	cachehits = cachemisses = 0;
+	nmisses = 0;
+	cachedir = mygetenv("CSCOPE_CACHEDIR", "");
+	if (*cachedir == '\0') {
+		cachedir = NULL;
+	} else if (stat(cachedir, &statstruct) != 0 ||
+		   !S_ISDIR(statstruct.st_mode)) {
+		posterr("cscope: cache directory %s not found\n", cachedir);
+		cachedir = NULL;
+	}
+	return(cachedir != NULL);
+}
+
+/* get the key of a source file's fragment; returns NO if the cache is not
+   used or the file cannot be read */
+
+BOOL
+cachekey(char *file, char *key)
+{
+	char	buf[BUFSIZ];
+	char	*s;
+	FILE	*f;
+	long	length;
+	int	n;
+
+	if (cachedir == NULL || (f = myfopen(file, "rb")) == NULL) {
+		return(NO);
+	}
+	hash1 = 2166136261UL;
+	hash2 = 5381;
+
+	/* everything else the data depends on */
+	if ((s = strrchr(mybasename(file), '.')) == NULL) {
+		s = "";
+	}
+	n = snprintf(buf, sizeof(buf), "%d%s %d %d %d %s\n", FILEVERSION,
+		     FIXVERSION, CACHEVERSION, compress, trun_syms, s);
+	hashbytes(buf, n);
+
+	/* the file text */
+	length = 0;
+	while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+		hashbytes(buf, n);
+		length += n;
+	}
+	if (ferror(f)) {
+		fclose(f);
+		return(NO);
+	}
+	fclose(f);
+	snprintf(key, CACHEKEYLEN + 1, "%08lx%08lx%08lx", hash1, hash2,
+		 length & 0xffffffffUL);
+	return(YES);
+}
+
+/* open a fragment, positioned at its start, and count the lookup; returns
+   -1 if it is not in the cache */
+
+int
+cacheopen(char *key)
+{
+	char	path[PATHLEN + 1];
+	char	header[PATLEN + 1];
+	struct	stat	statstruct;
+	long	length;
+	int	fd, n, version, fragversion, headerlen;
+
+	cachepath(key, path, sizeof(path));
+	if ((fd = open(path, O_BINARY | O_RDONLY)) == -1) {
+		++cachemisses;
+		return(-1);
+	}
+	/* check the header, and that the fragment is complete */
+	headerlen = 0;
+	if ((n = read(fd, header, sizeof(header) - 1)) > 0) {
+		header[n] = '\0';
+		if (sscanf(header, "cscope %d fragment %d %ld%n", &version,
+			   &fragversion, &length, &headerlen) != 3) {
+			headerlen = 0;
+		}
+	}
+	if (headerlen == 0 || version != FILEVERSION ||
+	    fragversion != CACHEVERSION || fstat(fd, &statstruct) != 0 ||
+	    statstruct.st_size != headerlen + length ||
+	    lseek(fd, 0L, 0) == -1) {
+		close(fd);
+		unlink(path);
+		++cachemisses;
+		return(-1);
+	}
+	/* note its use for the eviction order */
+	utime(path, NULL);
+	++cachehits;
+	return(fd);
+}
+
+/* note that the data of the file output by crossref() between the
+   offsets is to be put into the cache when the database is complete */
+
+void
+cachestore(char *key, long start, long end)
+{
+	if (nmisses == mmisses) {
+		mmisses += 256;
+		misses = myrealloc(misses, mmisses * sizeof(MISS));
+	}
+	strcpy(misses[nmisses].key, key);
+	misses[nmisses].start = start;
+	misses[nmisses].end = end;
+	++nmisses;
+}
+
+/* write the fragments noted by cachestore() from the complete new
+   database, report the lookups, and keep the cache within its size
+   limit */
+
+void
+cachefinish(void)
+{
+	char	msg[MSGLEN + 1];
+	FILE	*newdata;
+	long	limit;
+	long	i;
+
+	if (cachedir == NULL) {
+		return;
+	}
+	/* in database order, so it is read once from start to end */
+	if (nmisses > 0 && (newdata = myfopen(newreffile, "rb")) != NULL) {
+		for (i = 0; i < nmisses; ++i) {
+			cachewrite(newdata, &misses[i]);
+		}
+		fclose(newdata);
+	}
+	nmisses = 0;
+	if (verbosemode == YES) {
+		snprintf(msg, sizeof(msg),
+			 "cscope: fragment cache: %lu hits, %lu misses",
+			 cachehits, cachemisses);
+		postmsg(msg);
+	}
+	limit = atol(mygetenv("CSCOPE_CACHESIZE", ""));
+	if (limit <= 0) {
+		limit = CACHESIZE;
+	}
+	cachetrim(limit * 1024 * 1024);
+}
+
+/* get the file name of a fragment */
+
+static void
+cachepath(char *key, char *path, int size)
+{
+	snprintf(path, size, "%s/%s%s", cachedir, key, FRAGSUFFIX);
+}
+
+/* write a fragment from the data of its file in the new database */
+
+static void
+cachewrite(FILE *newdata, MISS *miss)
+{
+	char	path[PATHLEN + 1];
+	char	temp[PATHLEN + 16];	/* path and a process number */
+	char	buf[BUFSIZ];
+	FILE	*f;
+	long	start = miss->start;
+	long	end = miss->end;
+	long	n;
+	int	c;
+
+	/* find the end of the file name */
+	if (fseek(newdata, start, SEEK_SET) == -1) {
+		return;
+	}
+	while (start < end && (c = getc(newdata)) != EOF && c != '\n') {
+		++start;
+	}
+	if (start >= end || fseek(newdata, start, SEEK_SET) == -1) {
+		return;
+	}
+	/* write the fragment under a temporary name, so a build reading
+	   the cache at the same time never sees part of it */
+	cachepath(miss->key, path, sizeof(path));
+	snprintf(temp, sizeof(temp), "%s.%d", path, (int) getpid());
+	if ((f = myfopen(temp, "wb")) == NULL) {
+		return;
+	}
+	fprintf(f, "cscope %d fragment %d %ld", FILEVERSION, CACHEVERSION,
+		end - start + 2);
+	for (n = end - start; n > 0; n -= sizeof(buf)) {
+		c = (n < (long) sizeof(buf)) ? n : sizeof(buf);
+		if (fread(buf, 1, c, newdata) != c ||
+		    fwrite(buf, 1, c, f) != c) {
+			break;
+		}
+	}
+	/* end with the mark of the next file */
+	putc(NEWFILE, f);
+	putc('\n', f);
+	if (fclose(f) == EOF || n > 0 || rename(temp, path) == -1) {
+		unlink(temp);
+	}
+}
+
+/* remove the temporaries of builds that were stopped, and the least
+   recently used fragments until the rest fit in the limit */
+
+static void
+cachetrim(long limit)
+{
+	DIR	*dirfile;
+	struct	dirent	*entry;
+	struct	stat	statstruct;
+	char	path[PATHLEN + 1];
+	FRAGMENT *frags = NULL;
+	long	nfrags = 0, mfrags = 0;
+	long	total = 0;
+	long	i;
+	time_t	now;
+	char	*s;
+	int	len;
+
+	if ((dirfile = opendir(cachedir)) == NULL) {
+		return;
+	}
+	now = time(NULL);
+	while ((entry = readdir(dirfile)) != NULL) {
+		/* a fragment being written is named with a process number
+		   after the suffix */
+		if ((s = strstr(entry->d_name, FRAGSUFFIX ".")) != NULL) {
+			s += strlen(FRAGSUFFIX ".");
+			if (*s != '\0' && strspn(s, "0123456789") == strlen(s)) {
+				snprintf(path, sizeof(path), "%s/%s", cachedir,
+					 entry->d_name);
+				if (stat(path, &statstruct) == 0 &&
+				    now - statstruct.st_mtime > TEMPAGE) {
+					unlink(path);
+				}
+				continue;
+			}
+		}
+		len = strlen(entry->d_name) - strlen(FRAGSUFFIX);
+		if (len <= 0 || strcmp(entry->d_name + len, FRAGSUFFIX) != 0) {
+			continue;
+		}
+		snprintf(path, sizeof(path), "%s/%s", cachedir, entry->d_name);
+		if (stat(path, &statstruct) != 0) {
+			continue;
+		}
+		if (nfrags == mfrags) {
+			mfrags += 256;
+			frags = myrealloc(frags, mfrags * sizeof(FRAGMENT));
+		}
+		frags[nfrags].name = my_strdup(path);
+		frags[nfrags].size = statstruct.st_size;
+		frags[nfrags].used = statstruct.st_mtime;
+		total += statstruct.st_size;
+		++nfrags;
+	}
+	closedir(dirfile);
+
+	if (total > limit) {
+		qsort(frags, nfrags, sizeof(FRAGMENT), usedcompare);
+		for (i = 0; i < nfrags && total > limit; ++i) {
+			if (unlink(frags[i].name) == 0) {
+				total -= frags[i].size;
+			}
+		}
+	}
+	for (i = 0; i < nfrags; ++i) {
+		free(frags[i].name);
+	}
+	free(frags);
+}
+
+/* add bytes to the FNV-1a and Bernstein hashes of the fragment key */
+
+static void
+hashbytes(char *s, long n)
+{
+	unsigned char c;
+
+	while (n-- > 0) {
+		c = *s++;
+		hash1 = ((hash1 ^ c) * 16777619UL) & 0xffffffffUL;
+		hash2 = (hash2 * 33 + c) & 0xffffffffUL;
+	}
+}
+
+/* least recently used comparison function for qsort */
+
+static int
+usedcompare(const void *f1, const void *f2)
+{
+	time_t	u1 = ((FRAGMENT *) f1)->used;
+	time_t	u2 = ((FRAGMENT *) f2)->used;
+
+	return((u1 > u2) - (u1 < u2));
+}
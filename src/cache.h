@@ -0,0 +1,24 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	crossref fragment cache definitions
+ */
+
+#ifndef CSCOPE_CACHE_H
+#define CSCOPE_CACHE_H
+
+#include "global.h"
+
+#define	CACHEVERSION	1	/* fragment format version */
+#define	CACHEKEYLEN	24	/* length of a fragment key */
+#define	CACHESIZE	64	/* default cache size limit in megabytes */
+
+extern	unsigned long cachehits;	/* fragments found in the cache */
+extern	unsigned long cachemisses;	/* fragments not found */
+
+BOOL	cacheinit(void);
+BOOL	cachekey(char *file, char *key);
+int	cacheopen(char *key);
+void	cachestore(char *key, long start, long end);
+void	cachefinish(void);
+
+#endif /* CSCOPE_CACHE_H */
@@ -0,0 +1,538 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	call graph index
+ *
+ *	The index is built from a complete cross-reference and holds, for
+ *	every function and macro name, the list of calls it makes and the
+ *	list of calls made to it.  It also maps the database offset of
+ *	each definition to the name defined, so the inverted index search
+ *	can name the function of a reference without reading the
+ *	cross-reference.  The file is mapped read-only when the
+ *	database is opened, and walking it keeps all its state in the
+ *	caller's frame, so any number of queries can run on it at once.
+ */
+
+#include "global.h"
+
+#include "alloc.h"
+#include "build.h"		/* for symrefs */
+#include "callgraph.h"
+#include "scanner.h"		/* for the mark characters */
+#include <sys/stat.h>
+
+#define	CALLINC		10000	/* call list size increment */
+#define	DEFINC		10000	/* definition list size increment */
+#define	HASHINIT	4096	/* initial name hash table size */
+#define	NAMEINC		1000	/* name list size increment */
+#define	POOLINC		65536	/* name string space size increment */
+
+typedef	struct {		/* call found in the cross-reference */
+	long	caller;		/* calling function or macro */
+	long	callee;		/* called function */
+	long	file;		/* source file index */
+	long	offset;		/* database offset of the call */
+} CALL;
+
+static	char	*pool;		/* name string space */
+static	long	npool, mpool;
+static	long	*names;		/* name offsets by node number */
+static	long	nnames, mnames;
+static	long	*files;		/* file name offsets by file index */
+static	long	nfiles, mfiles;
+static	long	*hashtab;	/* open addressed name hash table */
+static	long	hashsize;
+static	CALL	*calls;		/* calls in database order */
+static	long	ncalls, mcalls;
+static	CGDEF	*defs;		/* definitions in database order */
+static	long	ndefs, mdefs;
+
+static	long	addname(char *s);
+static	void	addcall(long caller, long callee, long file, long offset);
+static	long	adddef(int type);
+static	long	cgnode(char *name);
+static	void	cgfree(void);
+static	int	cgnamecmp(const void *a, const void *b);
+static	BOOL	cgwrite(char *cgfile, long *order, long *rank);
+static	unsigned long namehash(char *s);
+
+/* build the call graph index from the cross-reference open on symrefs */
+
+long
+cgmake(char *cgfile)
+{
+	char	name[PATLEN + 1];	/* function, macro or file name */
+	long	fcn = -1;		/* current function */
+	long	macro = -1;		/* current macro */
+	long	caller;
+	long	offset;
+	long	*order, *rank;
+	long	i;
+
+	hashsize = HASHINIT;
+	hashtab = mymalloc(hashsize * sizeof(long));
+	for (i = 0; i < hashsize; ++i) {
+		hashtab[i] = -1;
+	}
+	nnames = nfiles = ncalls = ndefs = npool = 0;
+
+	/* find the function definitions and calls in each file */
+	blocknumber = -1;
+	(void) read_block();
+	while (scanpast('\t') != NULL) {
+		switch (*blockp) {
+
+		case NEWFILE:		/* save file name */
+			skiprefchar();
+			fetch_string_from_dbase(name, sizeof(name));
+			if (*name == '\0') {	/* if end of symbols */
+				goto done;
+			}
+			if (nfiles == mfiles) {
+				mfiles += NAMEINC;
+				files = myrealloc(files, mfiles * sizeof(long));
+			}
+			files[nfiles++] = addname(name);
+			fcn = macro = -1;
+			break;
+
+		case DEFINE:		/* calls in a macro are made by it */
+			skiprefchar();
+			macro = adddef(DEFINE);
+			break;
+
+		case DEFINEEND:
+			macro = -1;
+			break;
+
+		case FCNDEF:		/* save calling function */
+			skiprefchar();
+			fcn = adddef(FCNDEF);
+			break;
+
+		case FCNEND:
+			fcn = -1;
+			break;
+
+		case FCNCALL:
+			offset = blocknumber * BUFSIZ + (blockp - block);
+			caller = (macro >= 0) ? macro : fcn;
+			if (caller < 0) {	/* not inside a function */
+				break;
+			}
+			skiprefchar();
+			fetch_string_from_dbase(name, sizeof(name));
+			addcall(caller, cgnode(name), nfiles - 1, offset);
+			break;
+		}
+	}
+done:
+	/* number the functions in name order so they can be found with a
+	   binary search */
+	order = mymalloc((nnames + 1) * sizeof(long));
+	rank = mymalloc((nnames + 1) * sizeof(long));
+	for (i = 0; i < nnames; ++i) {
+		order[i] = i;
+	}
+	qsort(order, nnames, sizeof(long), cgnamecmp);
+	for (i = 0; i < nnames; ++i) {
+		rank[order[i]] = i;
+	}
+	i = cgwrite(cgfile, order, rank) == YES ? ncalls : -1;
+	free(order);
+	free(rank);
+	cgfree();
+	return(i);
+}
+
+/* write the index file */
+
+static BOOL
+cgwrite(char *cgfile, long *order, long *rank)
+{
+	struct	stat	statstruct;
+	FILE	*out;
+	CGHEADER header;
+	CGFCN	*fcns;
+	CGEDGE	*edges;
+	long	*start;
+	long	size;
+	long	i, j;
+
+	if ((out = myfopen(cgfile, "wb")) == NULL) {
+		posterr("cscope: cannot create file %s", cgfile);
+		return(NO);
+	}
+	header.version = CGVERSION;
+	header.nfcns = nnames;
+	header.nfiles = nfiles;
+	header.nedges = ncalls;
+	header.ndefs = ndefs;
+	header.strsize = npool;
+	header.dbsize = (fstat(symrefs, &statstruct) == 0) ?
+		(long) statstruct.st_size : -1;
+	fwrite(&header, sizeof(header), 1, out);
+
+	/* the function table, with the names in string space order */
+	fcns = mycalloc(nnames + 1, sizeof(CGFCN));
+	for (i = 0; i < ncalls; ++i) {
+		++fcns[rank[calls[i].caller]].ncallees;
+		++fcns[rank[calls[i].callee]].ncallers;
+	}
+	size = 0;
+	for (i = j = 0; i < nnames; ++i) {
+		fcns[i].name = size;
+		size += strlen(pool + names[order[i]]) + 1;
+		fcns[i].callees = j;
+		j += fcns[i].ncallees;
+	}
+	for (i = j = 0; i < nnames; ++i) {
+		fcns[i].callers = j;
+		j += fcns[i].ncallers;
+	}
+	fwrite(fcns, sizeof(CGFCN), nnames, out);
+
+	/* the calls grouped by calling and then by called function, each
+	   group in database order */
+	edges = mymalloc((ncalls + 1) * sizeof(CGEDGE));
+	start = mymalloc((nnames + 1) * sizeof(long));
+	for (i = 0; i < nnames; ++i) {
+		start[i] = fcns[i].callees;
+	}
+	for (i = 0; i < ncalls; ++i) {
+		j = start[rank[calls[i].caller]]++;
+		edges[j].fcn = rank[calls[i].callee];
+		edges[j].file = calls[i].file;
+		edges[j].offset = calls[i].offset;
+	}
+	fwrite(edges, sizeof(CGEDGE), ncalls, out);
+	for (i = 0; i < nnames; ++i) {
+		start[i] = fcns[i].callers;
+	}
+	for (i = 0; i < ncalls; ++i) {
+		j = start[rank[calls[i].callee]]++;
+		edges[j].fcn = rank[calls[i].caller];
+		edges[j].file = calls[i].file;
+		edges[j].offset = calls[i].offset;
+	}
+	fwrite(edges, sizeof(CGEDGE), ncalls, out);
+	free(start);
+	free(edges);
+
+	/* the definitions, already in database order */
+	for (i = 0; i < ndefs; ++i) {
+		defs[i].fcn = rank[defs[i].fcn];
+	}
+	fwrite(defs, sizeof(CGDEF), ndefs, out);
+
+	/* the file names follow the function names in the string space */
+	for (i = 0; i < nfiles; ++i) {
+		j = files[i];
+		files[i] = size;
+		size += strlen(pool + j) + 1;
+		fwrite(&files[i], sizeof(long), 1, out);
+		files[i] = j;
+	}
+	for (i = 0; i < nnames; ++i) {
+		fputs(pool + names[order[i]], out);
+		putc('\0', out);
+	}
+	for (i = 0; i < nfiles; ++i) {
+		fputs(pool + files[i], out);
+		putc('\0', out);
+	}
+	free(fcns);
+	if (ferror(out) || fclose(out) == EOF) {
+		posterr("cscope: cannot write to file %s", cgfile);
+		unlink(cgfile);
+		return(NO);
+	}
+	return(YES);
+}
+
+/* get the node number of this function or macro name */
+
+static long
+cgnode(char *name)
+{
+	unsigned long h;
+	long	i, n;
+
+	/* grow the hash table when it is half full */
+	if (nnames >= hashsize / 2) {
+		free(hashtab);
+		hashsize *= 2;
+		hashtab = mymalloc(hashsize * sizeof(long));
+		for (i = 0; i < hashsize; ++i) {
+			hashtab[i] = -1;
+		}
+		for (n = 0; n < nnames; ++n) {
+			h = namehash(pool + names[n]) & (hashsize - 1);
+			while (hashtab[h] != -1) {
+				h = (h + 1) & (hashsize - 1);
+			}
+			hashtab[h] = n;
+		}
+	}
+	h = namehash(name) & (hashsize - 1);
+	while ((n = hashtab[h]) != -1) {
+		if (strequal(pool + names[n], name)) {
+			return(n);
+		}
+		h = (h + 1) & (hashsize - 1);
+	}
+	if (nnames == mnames) {
+		mnames += NAMEINC;
+		names = myrealloc(names, mnames * sizeof(long));
+	}
+	names[nnames] = addname(name);
+	hashtab[h] = nnames;
+	return(nnames++);
+}
+
+/* add a string to the name string space */
+
+static long
+addname(char *s)
+{
+	long	len = strlen(s) + 1;
+	long	offset = npool;
+
+	if (npool + len > mpool) {
+		mpool += (len > POOLINC) ? len : POOLINC;
+		pool = myrealloc(pool, mpool);
+	}
+	memcpy(pool + npool, s, len);
+	npool += len;
+	return(offset);
+}
+
+static void
+addcall(long caller, long callee, long file, long offset)
+{
+	if (ncalls == mcalls) {
+		mcalls += CALLINC;
+		calls = myrealloc(calls, mcalls * sizeof(CALL));
+	}
+	calls[ncalls].caller = caller;
+	calls[ncalls].callee = callee;
+	calls[ncalls].file = file;
+	calls[ncalls].offset = offset;
+	++ncalls;
+}
+
+/* save the definition whose name starts at blockp, and return its node */
+
+static long
+adddef(int type)
+{
+	char	name[PATLEN + 1];
+	long	offset = blocknumber * BUFSIZ + (blockp - block);
+
+	fetch_string_from_dbase(name, sizeof(name));
+	if (ndefs == mdefs) {
+		mdefs += DEFINC;
+		defs = myrealloc(defs, mdefs * sizeof(CGDEF));
+	}
+	defs[ndefs].offset = offset;
+	defs[ndefs].fcn = cgnode(name);
+	defs[ndefs].type = type;
+	return(defs[ndefs++].fcn);
+}
+
+static unsigned long
+namehash(char *s)
+{
+	unsigned long h = 5381;
+
+	while (*s != '\0') {
+		h = h * 33 + (unsigned char) *s++;
+	}
+	return(h);
+}
+
+/* compare two node numbers by name for qsort */
+
+static int
+cgnamecmp(const void *a, const void *b)
+{
+	return(strcmp(pool + names[*(const long *) a],
+		      pool + names[*(const long *) b]));
+}
+
+/* free the storage used while building the index */
+
+static void
+cgfree(void)
+{
+	free(pool);
+	free(names);
+	free(files);
+	free(hashtab);
+	free(calls);
+	free(defs);
+	pool = NULL;
+	names = files = hashtab = NULL;
+	calls = NULL;
+	defs = NULL;
+	npool = mpool = nnames = mnames = nfiles = mfiles = ncalls = mcalls = 0;
+	ndefs = mdefs = 0;
+}
+
+/* map the call graph index, if it was made from a cross-reference of
+   this size */
+
+int
+cgopen(CGCONTROL *cg, char *cgfile, long dbsize)
+{
+	CGHEADER *h;
+	long	size;
+
+	cg->header = NULL;
+	if (os_mmap(cgfile, &cg->map) != 0) {
+		return(-1);
+	}
+	h = (CGHEADER *) cg->map.buffer;
+	if (cg->map.size < (int) sizeof(CGHEADER) ||
+	    h->version != CGVERSION || h->dbsize != dbsize) {
+		os_munmap(&cg->map);
+		return(-1);
+	}
+	size = sizeof(CGHEADER) + h->nfcns * sizeof(CGFCN) +
+		2 * h->nedges * sizeof(CGEDGE) + h->ndefs * sizeof(CGDEF) +
+		h->nfiles * sizeof(long) + h->strsize;
+	if (size != cg->map.size) {
+		posterr("cscope: incorrect call graph index file format: %s",
+			cgfile);
+		os_munmap(&cg->map);
+		return(-1);
+	}
+	cg->header = h;
+	cg->fcns = (CGFCN *) (h + 1);
+	cg->callees = (CGEDGE *) (cg->fcns + h->nfcns);
+	cg->callers = cg->callees + h->nedges;
+	cg->defs = (CGDEF *) (cg->callers + h->nedges);
+	cg->files = (long *) (cg->defs + h->ndefs);
+	cg->strings = (char *) (cg->files + h->nfiles);
+	return(0);
+}
+
+void
+cgclose(CGCONTROL *cg)
+{
+	if (cg->header != NULL) {
+		os_munmap(&cg->map);
+		cg->header = NULL;
+	}
+}
+
+/* find the function with this name, or return -1 */
+
+long
+cgfind(CGCONTROL *cg, char *name)
+{
+	long	low = 0, high, mid;
+	int	c;
+
+	if (cg->header == NULL) {
+		return(-1);
+	}
+	high = cg->header->nfcns - 1;
+	while (low <= high) {
+		mid = (low + high) / 2;
+		if ((c = strcmp(name, cg->strings + cg->fcns[mid].name)) == 0) {
+			return(mid);
+		}
+		if (c < 0) {
+			high = mid - 1;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return(-1);
+}
+
+/* find the first definition at or after this database offset, or return
+   NULL */
+
+CGDEF *
+cgdef(CGCONTROL *cg, long offset)
+{
+	long	low = 0, high, mid;
+
+	if (cg->header == NULL) {
+		return(NULL);
+	}
+	high = cg->header->ndefs;
+	while (low < high) {
+		mid = (low + high) / 2;
+		if (cg->defs[mid].offset < offset) {
+			low = mid + 1;
+		} else {
+			high = mid;
+		}
+	}
+	return(low < cg->header->ndefs ? cg->defs + low : NULL);
+}
+
+char *
+cgfcnname(CGCONTROL *cg, long fcn)
+{
+	return(cg->strings + cg->fcns[fcn].name);
+}
+
+char *
+cgfilename(CGCONTROL *cg, long file)
+{
+	return(cg->strings + cg->files[file]);
+}
+
+/* visit the calls made to (callers == YES) or by the root functions, then
+   those of the functions found, breadth first and up to depth levels
+   (no limit if depth is 0); each function is expanded only once, so
+   recursion and shared callees end the walk */
+
+void
+cgwalk(CGCONTROL *cg, long *roots, long nroots, BOOL callers, int depth,
+       CGVISIT visit, void *arg)
+{
+	unsigned char *seen;	/* expanded functions */
+	long	*queue;		/* functions to expand, by level */
+	long	head = 0, tail = 0, levelend;
+	long	fcn, i, n;
+	CGEDGE	*e;
+	int	level;
+
+	if (cg->header == NULL || (n = cg->header->nfcns) == 0) {
+		return;
+	}
+	seen = mycalloc(n / 8 + 1, 1);
+	queue = mymalloc(n * sizeof(long));
+	for (i = 0; i < nroots; ++i) {
+		fcn = roots[i];
+		if (!(seen[fcn >> 3] & (1 << (fcn & 7)))) {
+			seen[fcn >> 3] |= 1 << (fcn & 7);
+			queue[tail++] = fcn;
+		}
+	}
+	for (level = 1; head < tail && (depth <= 0 || level <= depth); ++level) {
+		for (levelend = tail; head < levelend; ++head) {
+			fcn = queue[head];
+			if (callers == YES) {
+				e = cg->callers + cg->fcns[fcn].callers;
+				n = cg->fcns[fcn].ncallers;
+			} else {
+				e = cg->callees + cg->fcns[fcn].callees;
+				n = cg->fcns[fcn].ncallees;
+			}
+			for (; n > 0; --n, ++e) {
+				(*visit)(cg, fcn, e, arg);
+				if (!(seen[e->fcn >> 3] & (1 << (e->fcn & 7)))) {
+					seen[e->fcn >> 3] |= 1 << (e->fcn & 7);
+					queue[tail++] = e->fcn;
+				}
+			}
+		}
+	}
+	free(queue);
+	free(seen);
+}
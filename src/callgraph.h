@@ -0,0 +1,68 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	call graph index definitions
+ */
+
+#ifndef CSCOPE_CALLGRAPH_H
+#define CSCOPE_CALLGRAPH_H
+
+#include "global.h"
+#include "os_wrapper.h"
+
+#define	CGVERSION	3	/* call graph index format version */
+
+typedef	struct {
+	long	version;	/* call graph index format version */
+	long	nfcns;		/* number of functions and macros */
+	long	nfiles;		/* number of source files */
+	long	nedges;		/* number of calls */
+	long	ndefs;		/* number of function and macro definitions */
+	long	strsize;	/* size of the string space */
+	long	dbsize;		/* size of the cross-reference it was made from */
+} CGHEADER;
+
+typedef	struct {
+	long	name;		/* name offset in the string space */
+	long	callees;	/* first edge in the callee list */
+	long	ncallees;	/* number of calls made by this function */
+	long	callers;	/* first edge in the caller list */
+	long	ncallers;	/* number of calls made to this function */
+} CGFCN;
+
+typedef	struct {
+	long	fcn;		/* function at the other end of the call */
+	long	file;		/* source file index of the call */
+	long	offset;		/* database offset of the call */
+} CGEDGE;
+
+typedef	struct {
+	long	offset;		/* database offset of the defined name */
+	long	fcn;		/* function or macro defined */
+	long	type;		/* FCNDEF or DEFINE */
+} CGDEF;
+
+typedef	struct {
+	mmap_info_t map;	/* mapped index file */
+	CGHEADER *header;	/* index parameters */
+	CGFCN	*fcns;		/* functions sorted by name */
+	CGEDGE	*callees;	/* calls grouped by calling function */
+	CGEDGE	*callers;	/* calls grouped by called function */
+	CGDEF	*defs;		/* definitions in database order */
+	long	*files;		/* source file name offsets */
+	char	*strings;	/* string space */
+} CGCONTROL;
+
+/* called for each call found while walking the graph */
+typedef	void	(*CGVISIT)(CGCONTROL *cg, long fcn, CGEDGE *edge, void *arg);
+
+void	cgclose(CGCONTROL *cg);
+CGDEF	*cgdef(CGCONTROL *cg, long offset);
+char	*cgfcnname(CGCONTROL *cg, long fcn);
+char	*cgfilename(CGCONTROL *cg, long file);
+long	cgfind(CGCONTROL *cg, char *name);
+long	cgmake(char *cgfile);
+int	cgopen(CGCONTROL *cg, char *cgfile, long dbsize);
+void	cgwalk(CGCONTROL *cg, long *roots, long nroots, BOOL callers,
+	       int depth, CGVISIT visit, void *arg);
+
+#endif /* CSCOPE_CALLGRAPH_H */
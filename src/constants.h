@@ -75,6 +75,8 @@
 #define	INVPOST	"cscope.po.out"	/* inverted index postings */
 #define	INVNAME2 "cscope.out.in"/* follows correct naming convention */
 #define	INVPOST2 "cscope.out.po"/* follows correct naming convention */
+#define	CGNAME	"cscope.cg.out"	/* call graph index */
+#define	LINENAME "cscope.ln.out"	/* source line table */
 
 #define	STMTMAX	10000		/* maximum source statement length */
 
@@ -103,7 +105,8 @@
 #define	REGEXP		6
 #define FILENAME	7
 #define INCLUDES	8
-#define	FIELDS		10
+#define	MULTISTRING	10
+#define	FIELDS		11
 
 #if (BSD || V9) && !__NetBSD__ && !__FreeBSD__
 # define TERMINFO	0	/* no terminfo curses */
@@ -41,6 +41,8 @@
 #include "build.h"
 #include "scanner.h"
 #include "alloc.h"
+#include "postsort.h"
+#include "linetab.h"
 
 #include <stdlib.h>
 #include <sys/stat.h>
@@ -64,7 +66,6 @@ extern BOOL dump_symbols;	/* print out symbols */
 
 #define	SYMBOLINC	20	/* symbol list size increment */
 
-long	dboffset;		/* new database offset */
 BOOL	errorsfound;		/* prompt before clearing messages */
 long	lineoffset;		/* source line database offset */
 long	npostings;		/* number of postings */
@@ -106,12 +107,14 @@ crossref(char *srcfile)
     }
 	
     entry_no = 0;
-    /* open the source file */
-    if ((yyin = myfopen(srcfile, "r")) == NULL) {
+    /* open the source file, in binary so its lines can be counted at
+       their offsets for the line table */
+    if ((yyin = myfopen(srcfile, "rb")) == NULL) {
 	cannotopen(srcfile);
 	errorsfound = YES;
 	return;
     }
+    linebegin(srcfile, &st);
     filename = srcfile;	/* save the file name for warning messages */
     putfilename(srcfile);	/* output the file name */
     dbputc('\n');
@@ -184,6 +187,7 @@ crossref(char *srcfile)
 	    if (symbols > 0) {
 		putcrossref();
 	    }
+	    lineend(token == LEXEOF);
 	    (void) fclose(yyin);	/* close the source file */
 
 	    /* output the leading tab expected by the next call */
@@ -193,6 +197,43 @@ crossref(char *srcfile)
     }
 }
 
+/* read the next block of the source file for the scanner, counting its
+   lines; on systems with a text mode its line ends are made those the
+   scanner would have had in it */
+
+int
+crossinput(char *buf, int size)
+{
+    int	n;
+#ifdef SETMODE
+    char    *s, *t, *end;
+    int	c;
+#endif
+
+    if ((n = fread(buf, 1, size, yyin)) <= 0) {
+	return(0);
+    }
+    linescan(buf, n);
+#ifdef SETMODE
+    /* make each carriage return and newline a newline */
+    for (s = t = buf, end = buf + n; s < end; ++s) {
+	if (*s != '\r' || s + 1 == end || s[1] != '\n') {
+	    *t++ = *s;
+	}
+    }
+    n = t - buf;
+    if (buf[n - 1] == '\r') {	/* the newline may be in the next block */
+	if ((c = getc(yyin)) == '\n') {
+	    linescan("\n", 1);
+	    buf[n - 1] = '\n';
+	} else if (c != EOF) {
+	    (void) ungetc(c, yyin);
+	}
+    }
+#endif
+    return(n);
+}
+
 /* save the symbol in the list */
 
 static void
@@ -228,17 +269,11 @@ savesymbol(int token, int num)
 void
 putfilename(char *srcfile)
 {
-	/* check for file system out of space */
-	/* note: dbputc is not used to avoid lint complaint */
-	if (putc(NEWFILE, newrefs) == EOF) {
-		cannotwrite(newreffile);
-		/* NOTREACHED */
-	}
-	++dboffset;
+	dbputc(NEWFILE);
 	if (invertedindex == YES) {
 		srcoffset[nsrcoffset++] = dboffset;
 	}
-	dbfputs(srcfile);
+	dbputs(srcfile);
 	fcnoffset = macrooffset = 0;
 }
 
@@ -252,13 +287,11 @@ putcrossref(void)
     BOOL    blank;          /* blank indicator */
     unsigned int symput = 0;     /* symbols output */
     int     type;
+    BOOL    assign;         /* symbol is assigned to */
 
     /* output the source line */
     lineoffset = dboffset;
-    dboffset += fprintf(newrefs, "%d ", lineno);
-#ifdef PRINTF_RETVAL_BROKEN
-    dboffset = ftell(newrefs); /* fprintf doesn't return chars written */
-#endif
+    dbprintf("%d ", lineno);
 
     /* HBB 20010425: added this line: */
     my_yytext[my_yyleng] = '\0';
@@ -288,10 +321,12 @@ putcrossref(void)
 	    }
 	    /* output the symbol */
 	    j = symbol[symput].last;
+	    assign = invertedindex == YES && type != INCLUDE &&
+		     isassignment(my_yytext + j);
 	    c = my_yytext[j];
 	    my_yytext[j] = '\0';
 	    if (invertedindex == YES) {
-		putposting(my_yytext + i, type);
+		putposting(my_yytext + i, type, assign);
 	    }
 	    writestring(my_yytext + i);
 	    dbputc('\n');
@@ -397,13 +432,15 @@ freecrossref()
 /* output the inverted index posting */
 
 void
-putposting(char *term, int type)
+putposting(char *term, int type, BOOL assign)
 {
 	long	i, n;
 	char	*s;
 	int	digits;		/* digits output */
 	long	offset;		/* function/macro database offset */
 	char	buf[11];		/* number buffer */
+	char	line[PATLEN + 40];	/* posting */
+	char	*p;
 
 	/* get the function or macro name offset */
 	offset = fcnoffset;
@@ -434,36 +471,40 @@ putposting(char *term, int type)
 		++term;
 	}
 	/* output the posting, which should be as small as possible to reduce
-	   the temp file size and sort time */
-	(void) fputs(term, postings);
-	(void) putc(' ', postings);
+	   the sort memory and time */
+	p = line;
+	for (s = term; *s != '\0' && p < line + PATLEN; ) {
+		*p++ = *s++;
+	}
+	*p++ = ' ';
 
 	/* the line offset is padded so postings for the same term will sort
 	   in ascending line offset order to order the references as they
 	   appear withing a source file */
 	ltobase(lineoffset);
 	for (i = PRECISION - digits; i > 0; --i) {
-		(void) putc('!', postings);
+		*p++ = '!';
 	}
 	do {
-		(void) putc(*s, postings);
+		*p++ = *s;
 	} while (*++s != '\0');
 	
 	/* postings are also sorted by type */
-	(void) putc(type, postings);
+	if (assign == YES) {
+		*p++ = type | ASSIGNFLAG;
+	} else {
+		*p++ = type;
+	}
 	
 	/* function or macro name offset */
 	if (offset > 0) {
-		(void) putc(' ', postings);
+		*p++ = ' ';
 		ltobase(offset);
 		do {
-			(void) putc(*s, postings);
+			*p++ = *s;
 		} while (*++s != '\0');
 	}
-	if (putc('\n', postings) == EOF) {
-		cannotwrite(temp1);
-		/* NOTREACHED */
-	}
+	postput(line, p - line);
 	++npostings;
 }
 
@@ -476,8 +517,8 @@ writestring(char *s)
 	int	i;
 	
 	if (compress == NO) {
-		/* Save some I/O overhead by using puts() instead of putc(): */
-		dbfputs(s);
+		/* Save some overhead by using dbputs() instead of dbputc(): */
+		dbputs(s);
 		return;
 	} 
 	/* compress digraphs */
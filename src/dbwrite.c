@@ -0,0 +1,354 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	buffered database writer
+ *
+ *	The new database is put into large output buffers, so a byte costs a
+ *	compare and a store, and its offset is the buffer's offset plus the
+ *	bytes in it.  A full buffer goes to a writer thread, which writes
+ *	all the buffers it has been given with one os_writev() while the
+ *	next ones are filled.  The buffers are aligned, and each one but the
+ *	first ends at a multiple of its size in the file, so if the
+ *	CSCOPE_DIRECTIO environment variable is set to a number of megabytes,
+ *	the full buffers past that much of the database are written around
+ *	the system cache, which a huge database would only fill with data
+ *	that is not read again soon.
+ */
+
+#include "global.h"
+
+#include "alloc.h"
+#include "dbwrite.h"
+#include "library.h"
+#include "os_wrapper.h"
+
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <pthread.h>
+
+char	*dbbuf;			/* output buffer being filled */
+char	*dbnext;		/* its next byte */
+char	*dbend;			/* its end */
+long	dbbase;			/* database offset of its start */
+
+typedef	struct {
+	char	*data;		/* aligned data */
+	char	*space;		/* as allocated */
+	long	offset;		/* database offset of the data */
+	long	len;		/* data length */
+} DBBUF;
+
+static	DBBUF	bufs[DBBUFS];	/* used in turn */
+static	unsigned long filled;	/* buffers given to the writer */
+static	unsigned long written;	/* buffers it has written */
+static	char	*dbpath;	/* database file name */
+static	int	dbfd = -1;	/* database file */
+static	int	directfd = -1;	/* it opened for direct I/O, or -1 */
+static	long	directstart;	/* offset to start direct I/O at */
+static	BOOL	failed;		/* a write failed */
+static	BOOL	quitting;	/* the writer thread is to exit */
+static	BOOL	started;	/* the writer thread is running */
+static	pthread_t writer;
+static	pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static	pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+static	void	dbstart(long offset);
+static	void	handoff(void);
+static	void	nextbuf(long offset);
+static	BOOL	writebufs(unsigned long first, unsigned long last);
+static	void	*writethread(void *arg);
+
+/* create the new database */
+
+BOOL
+dbcreate(char *path)
+{
+	if ((dbfd = open(path, O_BINARY | O_WRONLY | O_CREAT | O_TRUNC,
+			 0666)) == -1) {
+		return(NO);
+	}
+	dbpath = path;
+	dbstart(0L);
+	return(YES);
+}
+
+/* reopen the new database to continue it at the offset, discarding what
+   follows it */
+
+BOOL
+dbreopen(char *path, long offset)
+{
+	struct	stat	statstruct;
+
+	if ((dbfd = open(path, O_BINARY | O_WRONLY)) == -1) {
+		return(NO);
+	}
+	if (fstat(dbfd, &statstruct) != 0 || statstruct.st_size < offset ||
+	    os_truncate(dbfd, offset) != 0) {
+		close(dbfd);
+		dbfd = -1;
+		return(NO);
+	}
+	dbpath = path;
+	dbstart(offset);
+	return(YES);
+}
+
+/* put a string into the database */
+
+void
+dbputs(char *s)
+{
+	long	len, n;
+
+	len = strlen(s);
+	while (len > 0) {
+		if (dbnext == dbend) {
+			handoff();
+		}
+		n = dbend - dbnext;
+		if (n > len) {
+			n = len;
+		}
+		memcpy(dbnext, s, n);
+		dbnext += n;
+		s += n;
+		len -= n;
+	}
+}
+
+/* put formatted output into the database */
+
+void
+dbprintf(char *format, ...)
+{
+	char	buf[BUFSIZ];
+	va_list	ap;
+
+	va_start(ap, format);
+	vsnprintf(buf, sizeof(buf), format, ap);
+	va_end(ap);
+	dbputs(buf);
+}
+
+/* put a byte into the database when the buffer is full */
+
+void
+dbputslow(int c)
+{
+	handoff();
+	*dbnext++ = c;
+}
+
+/* write out everything put so far */
+
+void
+dbflush(void)
+{
+	handoff();
+	if (started == YES) {
+		pthread_mutex_lock(&lock);
+		while (written != filled) {
+			pthread_cond_wait(&cond, &lock);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+	if (failed == YES) {
+		cannotwrite(dbpath);
+		/* NOTREACHED */
+	}
+}
+
+/* write out everything put so far, and make sure it is on the disk */
+
+BOOL
+dbsync(void)
+{
+	dbflush();
+	return(os_sync(dbfd) == 0);
+}
+
+/* continue the database at the offset, after writing out what was put, to
+   rewrite part of it */
+
+void
+dbrewrite(long offset)
+{
+	dbflush();
+	nextbuf(offset);
+}
+
+/* write out the rest of the database and close it */
+
+void
+dbclose(void)
+{
+	int	i;
+
+	dbflush();
+	if (started == YES) {
+		pthread_mutex_lock(&lock);
+		quitting = YES;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+		pthread_join(writer, NULL);
+		started = NO;
+	}
+	if (directfd != -1) {
+		close(directfd);
+		directfd = -1;
+	}
+	if (close(dbfd) == -1) {
+		cannotwrite(dbpath);
+		/* NOTREACHED */
+	}
+	dbfd = -1;
+	for (i = 0; i < DBBUFS; ++i) {
+		free(bufs[i].space);
+		bufs[i].space = bufs[i].data = NULL;
+	}
+}
+
+/* set up the buffers and the writer thread for output at the offset */
+
+static void
+dbstart(long offset)
+{
+	int	i;
+
+	for (i = 0; i < DBBUFS; ++i) {
+		if (bufs[i].space == NULL) {
+			bufs[i].space = mymalloc(DBBUFSIZE + DBALIGN);
+			bufs[i].data = bufs[i].space + DBALIGN -
+				((size_t) bufs[i].space % DBALIGN);
+		}
+	}
+	filled = written = 0;
+	failed = quitting = NO;
+	directstart = atol(mygetenv("CSCOPE_DIRECTIO", "0")) * 1024 * 1024;
+	directfd = -1;
+	if (directstart > 0) {
+		directfd = os_open_direct(dbpath);
+	}
+	/* without the thread the buffers are written as they fill */
+	started = (pthread_create(&writer, NULL, writethread, NULL) == 0);
+	nextbuf(offset);
+}
+
+/* give the buffer being filled to the writer, and start the next one */
+
+static void
+handoff(void)
+{
+	DBBUF	*b = &bufs[filled % DBBUFS];
+	long	offset = dboffset;
+
+	b->len = dbnext - dbbuf;
+	if (b->len > 0) {
+		if (started == NO) {
+			if (writebufs(filled, filled + 1) == NO) {
+				failed = YES;
+			}
+			++filled;
+			++written;
+		} else {
+			pthread_mutex_lock(&lock);
+			++filled;
+			pthread_cond_broadcast(&cond);
+			pthread_mutex_unlock(&lock);
+		}
+	}
+	if (failed == YES) {
+		cannotwrite(dbpath);
+		/* NOTREACHED */
+	}
+	nextbuf(offset);
+}
+
+/* start the next buffer at the offset, once the writer is done with it */
+
+static void
+nextbuf(long offset)
+{
+	DBBUF	*b;
+
+	if (started == YES) {
+		pthread_mutex_lock(&lock);
+		while (filled - written >= DBBUFS) {
+			pthread_cond_wait(&cond, &lock);
+		}
+		pthread_mutex_unlock(&lock);
+	}
+	b = &bufs[filled % DBBUFS];
+	b->offset = offset;
+	dbbuf = dbnext = b->data;
+
+	/* end it at a multiple of the buffer size in the file */
+	dbend = dbbuf + DBBUFSIZE - offset % DBBUFSIZE;
+	dbbase = offset;
+}
+
+static void *
+writethread(void *arg)
+{
+	unsigned long first, last;
+	BOOL	ok;
+
+	pthread_mutex_lock(&lock);
+	for (;;) {
+		while (written == filled && quitting == NO) {
+			pthread_cond_wait(&cond, &lock);
+		}
+		if (written == filled) {
+			break;
+		}
+		first = written;
+		last = filled;
+		pthread_mutex_unlock(&lock);
+		ok = writebufs(first, last);
+		pthread_mutex_lock(&lock);
+		if (ok == NO) {
+			failed = YES;
+		}
+		written = last;
+		pthread_cond_broadcast(&cond);
+	}
+	pthread_mutex_unlock(&lock);
+	return(NULL);
+}
+
+/* write the buffers, which follow each other in the file, with a write for
+   each run of them that can or cannot use direct I/O */
+
+static BOOL
+writebufs(unsigned long first, unsigned long last)
+{
+	os_iovec_t iov[DBBUFS];
+	DBBUF	*b;
+	BOOL	direct, d;
+	int	fd, n;
+
+	while (first < last) {
+		n = 0;
+		direct = NO;
+		for (; first < last; ++first) {
+			b = &bufs[first % DBBUFS];
+			d = (directfd != -1 && b->offset >= directstart &&
+			     b->offset % DBALIGN == 0 && b->len % DBALIGN == 0);
+			if (n > 0 && d != direct) {
+				break;
+			}
+			direct = d;
+			iov[n].buffer = b->data;
+			iov[n].size = b->len;
+			++n;
+		}
+		fd = (direct == YES) ? directfd : dbfd;
+		b = &bufs[(first - n) % DBBUFS];
+		if (lseek(fd, b->offset, SEEK_SET) == -1 ||
+		    os_writev(fd, iov, n) != 0) {
+			return(NO);
+		}
+	}
+	return(YES);
+}
@@ -0,0 +1,34 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	buffered database writer definitions
+ */
+
+#ifndef CSCOPE_DBWRITE_H
+#define CSCOPE_DBWRITE_H
+
+#include "global.h"
+
+#define	DBBUFSIZE	(1024 * 1024)	/* output buffer size */
+#define	DBBUFS		4		/* output buffers */
+#define	DBALIGN		4096		/* direct I/O alignment */
+
+extern	char	*dbbuf;		/* output buffer being filled */
+extern	char	*dbnext;	/* its next byte */
+extern	char	*dbend;		/* its end */
+extern	long	dbbase;		/* database offset of its start */
+
+/* the new database offset, and output that updates it */
+#define	dboffset	(dbbase + (dbnext - dbbuf))
+#define	dbputc(c)	(dbnext < dbend ? (void) (*dbnext++ = (c)) : dbputslow(c))
+
+BOOL	dbcreate(char *path);
+BOOL	dbreopen(char *path, long offset);
+void	dbputs(char *s);
+void	dbprintf(char *format, ...);
+void	dbputslow(int c);
+void	dbflush(void);
+BOOL	dbsync(void);
+void	dbrewrite(long offset);
+void	dbclose(void);
+
+#endif /* CSCOPE_DBWRITE_H */
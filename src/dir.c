@@ -57,6 +57,7 @@ char	currentdir[PATHLEN + 1];/* current directory */
 char	**incdirs;		/* #include directories */
 char	**srcdirs;		/* source directories */
 char	**srcfiles;		/* source files */
+PATHTRIE srctrie;		/* source file paths */
 unsigned long nincdirs;		/* number of #include directories */
 unsigned long nsrcdirs;		/* number of source directories */
 unsigned long nsrcfiles;	/* number of source files */
@@ -67,11 +68,6 @@ static	unsigned long mincdirs = DIRINC; /* maximum number of #include directorie
 static	unsigned long msrcdirs; /* maximum number of source directories */
 static	unsigned long nvpsrcdirs; /* number of view path source directories */
 
-static	struct	listitem {	/* source file names without view pathing */
-	char	*text;
-	struct	listitem *next;
-} *srcnames[HASHMOD];
-
 /* Internal prototypes: */
 static	BOOL	accessible_file(char *file);
 static	BOOL	issrcfile(char *file);
@@ -649,14 +645,11 @@ incfile(char *file, char *type)
 BOOL
 infilelist(char *path)
 {
-    struct listitem *p;
+    long    node;
 
-    for (p = srcnames[hash(compath(path)) % HASHMOD];
-	 p != NULL;
-	 p = p->next) {
-	if (strequal(path, p->text)) {
-	    return(YES);
-	}
+    if ((node = ptfind(&srctrie, compath(path))) >= 0
+	&& srctrie.nodes[node].file >= 0) {
+	return(YES);
     }
     return(NO);
 }
@@ -713,21 +706,15 @@ inviewpath(char *file)
 void
 addsrcfile(char *path)
 {
-	struct	listitem *p;
-	int	i;
-	
 	/* make sure there is room for the file */
 	if (nsrcfiles == msrcfiles) {
 		msrcfiles += SRCINC;
 		srcfiles = myrealloc(srcfiles, msrcfiles * sizeof(char *));
 	}
-	/* add the file to the list */
-	srcfiles[nsrcfiles++] = my_strdup(compath(path));
-	p = mymalloc(sizeof(struct listitem));
-	p->text = my_strdup(compath(path));
-	i = hash(p->text) % HASHMOD;
-	p->next = srcnames[i];
-	srcnames[i] = p;
+	/* add the file to the list and the path trie */
+	srcfiles[nsrcfiles] = my_strdup(compath(path));
+	(void) ptadd(&srctrie, srcfiles[nsrcfiles], nsrcfiles);
+	++nsrcfiles;
 }
 
 /* free the memory allocated for the source file list */
@@ -735,9 +722,6 @@ addsrcfile(char *path)
 void
 freefilelist(void)
 {
-	struct	listitem *p, *nextp;
-	int	i;
-
 	/* if '-d' option is used a string space block is allocated */	
 	if (isuptodate == NO) {
 		while (nsrcfiles > 0) {
@@ -755,13 +739,5 @@ freefilelist(void)
 	msrcfiles = 0;
 	srcfiles=0;
 	
-	for (i = 0; i < HASHMOD; ++i) {
-		for (p = srcnames[i]; p != NULL; p = nextp) {
-			/* HBB 20000421: avoid memory leak */
-			free(p->text);
-			nextp = p->next;
-			free(p);
-		}
-		srcnames[i] = NULL;
-	}
+	ptfree(&srctrie);
 }
@@ -113,6 +113,7 @@ static	struct	{		/* text of input fields */
 	{"Find this", "file",				findfile},
 	{"Find", "files #including this file",		findinclude},
 	{"Find", "assignments to this symbol", 		findassign},
+	{"Find any of these", "text strings",		findmulti},
 	{"Find all", "function definitions",		findallfcns},	/* samuel only */
 };
 
@@ -169,6 +170,9 @@ display(void)
 #else
 	printw("Cscope version %d%s", FILEVERSION, FIXVERSION);
 #endif
+	if (partialdb == YES) {
+	    addstr(" (partial database)");
+	}
 	move(0, COLS - (int) sizeof(helpstring));
 	addstr(helpstring);
     } else if (totallines == 0) {
@@ -183,6 +187,9 @@ display(void)
 	    printw("%c%s: %s", toupper((unsigned char)fields[field].text2[0]),
 		   fields[field].text2 + 1, Pattern);
 	}
+	if (partialdb == YES) {
+	    addstr(" (partial database, results may be incomplete)");
+	}
 	/* display the column headings */
 	move(2, 2);
 	if (ogs == YES && field != FILENAME) {
@@ -429,7 +436,8 @@ search(void)
 	savesig = signal(SIGINT, jumpback);
 	if (sigsetjmp(env, 1) == 0) {
 		f = fields[field].findfcn;
-		if (f == findregexp || f == findstring || (STRING == field ) ) {
+		if (f == findregexp || f == findstring || f == findmulti ||
+		    (STRING == field ) ) {
 			findresult = (*f)(Pattern);
 		} else {
 			if ((nonglobalrefs = myfopen(temp2, "wb")) == NULL) {
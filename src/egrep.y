@@ -35,6 +35,21 @@
 
 /*
  * egrep -- fine lines containing a regular expression
+ *
+ * The states of the automaton are made as the text needs them, and
+ * cached, so only those a search reaches are made.  Each state is a set
+ * of positions of the pattern, and has a row of next states, one for
+ * each class of characters that no position of the pattern tells apart.
+ * Each thread has a cache of its own, which grows up to DFAMEM bytes.
+ * When it is full, the rest of the file is searched with states that
+ * are made for each character and not kept, and the cache is emptied
+ * for the next file.
+ *
+ * Most patterns have a string that every match has, such as "foo_" in
+ * foo_[a-z]+_init.  When they do, and it is at least MINFACTOR long, a
+ * file is read in blocks and searched for the string, and the automaton
+ * only runs on the lines that have it.  A file without it is skipped.
+ * With -i, it is found in either case.
  */
 %}
 
@@ -46,48 +61,128 @@
 
 %{
 #include "global.h"
+#include "alloc.h"
+#include "bm_search.h"		/* for bm_search_count_lines() and output */
 #include <ctype.h>
 #include <stdio.h>
 
 #include <setjmp.h>	/* jmp_buf */
+#include <pthread.h>
 
 #define nextch()	(*input++)
 
+/* the file index of a position in the egrep() buffer, which is from the
+   previous pass over it if it is past the next character */
+#define BUFINDEX(q)	(lp.bufbase + ((q) - buf) - ((q) > p ? 2*BUFSIZ : 0))
+
+/* A state is given by the offset of its row of next states, or if it has
+   matched, by -2 less the offset, so a step is an add, a load and a test.
+   A next state not made yet is -1. */
+#define DFASTATE(d, s)	((d)->accept[s] ? -2 - (s) * ncls : (s) * ncls)
+#define ACCEPT(v)	((v) < 0)
+
+/* the next state from a state on a character class, from the rows of a
+   cache, which may move when a state is made; the state must not have
+   matched */
+#define NEXT(d, rows, v, k, t)	(((t) = (rows)[(v) + (k)]) == -1 ? \
+				 ((t) = dfanext((d), (v), (k)), (rows) = (d)->next, (t)) : (t))
+
 #define MAXLIN 350
-#define MAXPOS 4000
+#define POSINC 4000	/* follow set space size increment */
 #define NCHARS 256
-#define NSTATES 128
+#define DFAMEM (1 << 20)	/* size a state cache grows to */
+#define MINFACTOR 2	/* length of a string worth searching for first */
+#define FACTORBUF 65536	/* text read at a time to search for it in */
 #define FINAL -1
-static	char gotofn[NSTATES][NCHARS];
-static	int state[NSTATES];
-static	char out[NSTATES];
 static	unsigned int line;
 static	int name[MAXLIN];
 static	unsigned int left[MAXLIN];
 static	unsigned int right[MAXLIN];
 static	unsigned int parent[MAXLIN];
 static	int foll[MAXLIN];
-static	int positions[MAXPOS];
+static	int *positions;	/* follow sets, each after its size */
+static	int maxpos;
 static	char chars[MAXLIN];
 static	int nxtpos;
 static	int nxtchar;
 static	int tmpstat[MAXLIN];
 static	int initstat[MAXLIN];
-static	int xstate;
 static	int count;
-static	int icount;
+static	unsigned char cls[NCHARS];	/* the class of each character */
+static	unsigned char lcls[NCHARS];	/* and of it in lower case, for -i */
+static	unsigned char classchar[NCHARS];	/* a character of each class */
+static	int ncls;
+static	long generation;	/* of the pattern, so the caches know it */
+static	pthread_key_t dfakey;
+static	pthread_once_t dfaonce = PTHREAD_ONCE_INIT;
 static	char *input;
-static	long lnum;
 static	int iflag;
 static	jmp_buf	env;	/* setjmp/longjmp buffer */
 static	char *message;	/* error message */
+static	char *factor;	/* a string every match has, or NULL */
+static	char *lfactor;	/* and in lower case, for -i */
+static	size_t factorlen;
+static	pthread_mutex_t statlock = PTHREAD_MUTEX_INITIALIZER;
+static	long nfiles;	/* files searched for the factor */
+static	long nfileskips;	/* and that did not have it */
+static	long nbytes;	/* text searched for the factor */
+static	long nscanned;	/* and of it, the lines run by the automaton */
+
+/* the strings that every match of a node has, at its start, at its end and
+   anywhere, and whether it only matches the one string */
+typedef	struct {
+	char	*pre;
+	char	*suf;
+	char	*in;
+	BOOL	exact;
+} FACTOR;
+
+/* a thread's cache of the states of the pattern */
+typedef	struct {
+	long	generation;	/* of the pattern the states are of */
+	BOOL	full;		/* no more states will be kept */
+	int	nstates;	/* states kept, which the two not kept follow */
+	int	mstates;
+	int	*next;		/* next DFASTATE by state and class, or -1 */
+	int	*set;		/* the positions of each state in sets */
+	char	*accept;	/* whether each state has matched */
+	int	*sets;		/* position sets, each after its size */
+	long	nsets, msets;
+	int	*hash;		/* states by the hash of their set, or -1 */
+	int	hsize;		/* a power of two */
+	int	list[MAXLIN + 1];	/* a set being made */
+	long	mark[MAXLIN + 1];	/* its positions, marked with the stamp */
+	long	stamp;
+} DFA;
+
+/* The pattern is only read by egrep(), so files can be searched with it
+   by several threads at once, each with a line position of its own. */
+typedef	struct {
+	long	lnum;		/* number of the line at file index counted */
+	long	counted;	/* or -1 before the first match */
+	long	bufbase;	/* file index of the buffer start */
+} LINEPOS;
 
 /* Internal prototypes: */
+static	void cfactor(void);
 static	void cfoll(int v);
-static	void cgotofn(void);
+static	char *catstr(char *a, char *b);
+static	char *commonstr(char *a, char *b, BOOL suffix);
+static	void factorscan(FILE *fptr, char *file, output_buffer_t *output,
+			char *format);
+static	void cclasses(void);
+static	void cstart(void);
 static	int cstate(int v);
 static	int member(int symb, int set, int torf);
-static	int notin(int n);
+static	int dfaadd(DFA *d, int n, int slot);
+static	DFA *dfaget(void);
+static	void dfakeyinit(void);
+static	void dfafree(void *p);
+static	unsigned int dfahash(int *list, int n);
+static	int dfanext(DFA *d, int v, int k);
+static	int dfastart(DFA *d);
+static	void dfareset(DFA *d);
+static	void split(unsigned char *in);
 static	void synerror(void);
 static	void overflo(void);
 static	void add(int *array, int n);
@@ -96,6 +191,8 @@ static	int unary(int x, int d);
 static	int node(int x, int l, int r);
 static	unsigned int cclenter(int x);
 static	unsigned int enter(int x);
+static	void lineat(FILE *fptr, char *buf, char *p, LINEPOS *lp, long to);
+static	void putline(output_buffer_t *output, char *buf, char *from, char *to);
 
 static int yylex(void);
 static int yyerror(char *);
@@ -302,16 +399,13 @@ cfoll(int v)
     }
 }
 
+/* the start state, the positions that can match first, less the leading
+   .* that lets a match start anywhere, which every state has */
+
 static void
-cgotofn(void)
+cstart(void)
 {
-    unsigned int i, n, s;
-    int c, k;
-    char symbol[NCHARS];
-    unsigned int j, l, pc, pos;
-    unsigned int nc;
-    int curpos;
-    unsigned int num, number, newpos;
+    unsigned int n;
 
     count = 0;
     for (n=3; n<=line; n++)
@@ -319,95 +413,74 @@ cgotofn(void)
     if (cstate(line-1)==0) {
 	tmpstat[line] = 1;
 	count++;
-	out[0] = 1;
     }
     for (n=3; n<=line; n++)
 	initstat[n] = tmpstat[n];
-    count--;		/*leave out position 1 */
-    icount = count;
-    tmpstat[1] = 0;
-    add(state, 0);
-    n = 0;
-    for (s = 0; s <= n; s++)  {
-	if (out[s] == 1)
+}
+
+/* the classes of characters that no position of the pattern tells apart;
+   a newline has a class of its own, since only the positions for ^ and $
+   match it */
+
+static void
+cclasses(void)
+{
+    unsigned char in[NCHARS];
+    unsigned int i, j, nc, pc;
+    int c;
+
+    memset(cls, 0, sizeof(cls));
+    ncls = 1;
+    memset(in, 0, sizeof(in));
+    in['\n'] = 1;
+    split(in);
+    for (i = 1; i < line; i++) {
+	if (left[i] != 0 || (c = name[i]) < 0) {
 	    continue;
-	for (i = 0; i < NCHARS; i++)
-	    symbol[i] = 0;
-	num = positions[state[s]];
-	count = icount;
-	for (i = 3; i <= line; i++)
-	    tmpstat[i] = initstat[i];
-	pos = state[s] + 1;
-	for (i = 0; i < num; i++) {
-	    curpos = positions[pos];
-	    if ((c = name[curpos]) >= 0) {
-		if (c < NCHARS) {
-		    symbol[c] = 1;
-		} else if (c == DOT) {
-		    for (k = 0; k < NCHARS; k++)
-			if (k != '\n')
-			    symbol[k] = 1;
-		} else if (c == CCL) {
-		    nc = chars[right[curpos]];
-		    pc = right[curpos] + 1;
-		    for (j = 0; j < nc; j++)
-			symbol[(unsigned char)(chars[pc++])] = 1;
-		} else if (c == NCCL) {
-		    nc = chars[right[curpos]];
-		    for (j = 0; j < NCHARS; j++) {
-			pc = right[curpos] + 1;
-			for (l = 0; l < nc; l++)
-			    if (j==(unsigned char)(chars[pc++]))
-				goto cont;
-			if (j != '\n')
-			    symbol[j] = 1;
-		    cont:
-			;
-		    }
-		}
+	}
+	memset(in, 0, sizeof(in));
+	if (c < NCHARS) {
+	    in[c] = 1;
+	} else if (c == DOT) {
+	    memset(in, 1, sizeof(in));
+	} else if (c == CCL || c == NCCL) {
+	    nc = chars[right[i]];
+	    pc = right[i] + 1;
+	    for (j = 0; j < nc; j++)
+		in[(unsigned char)(chars[pc++])] = 1;
+	    if (c == NCCL) {
+		for (j = 0; j < NCHARS; j++)
+		    in[j] = !in[j];
 	    }
-	    pos++;
-	} /* for (i) */
-	for (c=0; c<NCHARS; c++) {
-	    if (symbol[c] == 1) {
-		/* nextstate(s,c) */
-		count = icount;
-		for (i=3; i <= line; i++)
-		    tmpstat[i] = initstat[i];
-		pos = state[s] + 1;
-		for (i=0; i<num; i++) {
-		    curpos = positions[pos];
-		    if ((k = name[curpos]) >= 0)
-			if ((k == c)
-			    || (k == DOT)
-			    || (k == CCL && member(c, right[curpos], 1))
-			    || (k == NCCL && member(c, right[curpos], 0))
-			    ) {
-			    number = positions[foll[curpos]];
-			    newpos = foll[curpos] + 1;
-			    for (j = 0; j < number; j++) {
-				if (tmpstat[positions[newpos]] != 1) {
-				    tmpstat[positions[newpos]] = 1;
-				    count++;
-				}
-				newpos++;
-			    }
-			}
-		    pos++;
-		} /* end nextstate */
-		if (notin(n)) {
-		    if (n >= NSTATES)
-			overflo();
-		    add(state, ++n);
-		    if (tmpstat[line] == 1)
-			out[n] = 1;
-		    gotofn[s][c] = n;
-		} else {
-		    gotofn[s][c] = xstate;
-		}
-	    } /* if (symbol) */
-	} /* for(c) */
-    } /* for(s) */
+	} else {
+	    continue;
+	}
+	split(in);
+    }
+    for (c = NCHARS - 1; c >= 0; c--) {
+	classchar[cls[c]] = c;
+    }
+    for (c = 0; c < NCHARS; c++) {
+	lcls[c] = cls[tolower(c)];
+    }
+}
+
+/* split the classes with characters both in and not in a set */
+
+static void
+split(unsigned char *in)
+{
+    int	id[NCHARS][2];
+    int	c, k;
+
+    memset(id, -1, sizeof(id));
+    for (c = 0; c < NCHARS; c++) {
+	k = cls[c];
+	if (id[k][in[c]] < 0) {
+	    id[k][in[c]] = (id[k][!in[c]] < 0) ? k : ncls++;
+	}
+	cls[c] = id[k][in[c]];
+    }
 }
 
 static int
@@ -450,30 +523,15 @@ member(int symb, int set, int torf)
     return (!torf);
 }
 
-static int
-notin(int n)
-{
-	int i, j, pos;
-	for (i=0; i<=n; i++) {
-		if (positions[state[i]] == count) {
-			pos = state[i] + 1;
-			for (j=0; j < count; j++)
-				if (tmpstat[positions[pos++]] != 1) goto nxt;
-			xstate = i;
-			return (0);
-		}
-		nxt: ;
-	}
-	return (1);
-}
-
 static void
 add(int *array, int n)
 {
     unsigned int i;
 
-    if (nxtpos + count > MAXPOS)
-	overflo();
+    if (nxtpos + count + 1 > maxpos) {
+	maxpos += (count + 1 > POSINC) ? count + 1 : POSINC;
+	positions = myrealloc(positions, maxpos * sizeof(int));
+    }
     array[n] = nxtpos;
     positions[nxtpos++] = count;
     for (i=3; i <= line; i++) {
@@ -523,92 +581,433 @@ char *
 egrepinit(char *egreppat)
 {
     /* initialize the global data */
-    memset(gotofn, 0, sizeof(gotofn));
-    memset(state, 0, sizeof(state));
-    memset(out, 0, sizeof(out));
     line = 1;
     memset(name, 0, sizeof(name));
     memset(left, 0, sizeof(left));
     memset(right, 0, sizeof(right));
     memset(parent, 0, sizeof(parent));
     memset(foll, 0, sizeof(foll));
-    memset(positions, 0, sizeof(positions));
     memset(chars, 0, sizeof(chars));
     nxtpos = 0;
     nxtchar = 0;
     memset(tmpstat, 0, sizeof(tmpstat));
     memset(initstat, 0, sizeof(initstat));
-    xstate = 0;
     count = 0;
-    icount = 0;
     input = egreppat;
     message = NULL;
+    ++generation;
     if (setjmp(env) == 0) {
 	yyparse();
 	cfoll(line-1);
-	cgotofn();
+	cstart();
+	cclasses();
+	cfactor();
     }
+    nfiles = nfileskips = 0;
+    nbytes = nscanned = 0;
     return(message);
 }
 
+/* the longest string that every match of the pattern has; the nodes are
+   made after their children, so they are gone through in order */
+
+static void
+cfactor(void)
+{
+    FACTOR *f, *l, *r;
+    unsigned int i;
+    int c;
+
+    free(factor);
+    free(lfactor);
+    factor = lfactor = NULL;
+    f = mycalloc(line, sizeof(FACTOR));
+    for (i = 1; i < line; i++) {
+	c = name[i];
+	l = &f[left[i]];
+	r = &f[right[i]];
+	if (left[i] == 0) {
+	    /* a newline is for ^ or $, which are not in the text of a line */
+	    if (c > 0 && c < NCHARS && c != '\n') {
+		f[i].pre = mymalloc(2);
+		f[i].pre[0] = c;
+		f[i].pre[1] = '\0';
+		f[i].exact = YES;
+	    }
+	} else if (c == CAT) {
+	    f[i].exact = (l->exact == YES && r->exact == YES);
+	    f[i].pre = (l->exact == YES) ? catstr(l->pre, r->pre) : catstr(l->pre, "");
+	    f[i].suf = (r->exact == YES) ? catstr(l->suf, r->suf) : catstr(r->suf, "");
+	    f[i].in = catstr(l->suf, r->pre);
+	    if (strlen(l->in) > strlen(f[i].in)) {
+		free(f[i].in);
+		f[i].in = catstr(l->in, "");
+	    }
+	    if (strlen(r->in) > strlen(f[i].in)) {
+		free(f[i].in);
+		f[i].in = catstr(r->in, "");
+	    }
+	} else if (c == OR) {
+	    f[i].exact = (l->exact == YES && r->exact == YES &&
+			  strcmp(l->pre, r->pre) == 0);
+	    f[i].pre = commonstr(l->pre, r->pre, NO);
+	    f[i].suf = commonstr(l->suf, r->suf, YES);
+	    if (strstr(r->in, l->in) != NULL) {
+		f[i].in = catstr(l->in, "");
+	    } else if (strstr(l->in, r->in) != NULL) {
+		f[i].in = catstr(r->in, "");
+	    } else {
+		f[i].in = catstr((strlen(f[i].pre) >= strlen(f[i].suf)) ?
+				 f[i].pre : f[i].suf, "");
+	    }
+	} else if (c == PLUS) {
+	    f[i].pre = catstr(l->pre, "");
+	    f[i].suf = catstr(l->suf, "");
+	    f[i].in = catstr(l->in, "");
+	}
+	/* the rest, which may match nothing, have no strings */
+	if (f[i].pre == NULL) {
+	    f[i].pre = catstr("", "");
+	}
+	if (f[i].suf == NULL) {
+	    f[i].suf = catstr(f[i].pre, "");
+	}
+	if (f[i].in == NULL) {
+	    f[i].in = catstr(f[i].pre, "");
+	}
+    }
+    if ((factorlen = strlen(f[line - 1].in)) >= MINFACTOR) {
+	factor = f[line - 1].in;
+	f[line - 1].in = NULL;
+	lfactor = my_strdup(factor);
+	for (i = 0; i < factorlen; i++) {
+	    lfactor[i] = tolower((unsigned char) factor[i]);
+	}
+    }
+    for (i = 1; i < line; i++) {
+	free(f[i].pre);
+	free(f[i].suf);
+	free(f[i].in);
+    }
+    free(f);
+}
+
+/* a string made of two others */
+
+static char *
+catstr(char *a, char *b)
+{
+    char *s;
+
+    s = mymalloc(strlen(a) + strlen(b) + 1);
+    strcpy(s, a);
+    strcat(s, b);
+    return(s);
+}
+
+/* the longest start, or end, that two strings have in common */
+
+static char *
+commonstr(char *a, char *b, BOOL suffix)
+{
+    size_t la, lb, n;
+    char *s;
+
+    la = strlen(a);
+    lb = strlen(b);
+    for (n = 0; n < la && n < lb; n++) {
+	if (suffix == YES ? a[la - 1 - n] != b[lb - 1 - n] : a[n] != b[n]) {
+	    break;
+	}
+    }
+    s = mymalloc(n + 1);
+    memcpy(s, (suffix == YES) ? a + la - n : a, n);
+    s[n] = '\0';
+    return(s);
+}
+
+/* the calling thread's state cache, emptied if it is of another pattern
+   or was filled by the last file */
+
+static DFA *
+dfaget(void)
+{
+    DFA	*d;
+
+    pthread_once(&dfaonce, dfakeyinit);
+    if ((d = pthread_getspecific(dfakey)) == NULL) {
+	d = mycalloc(1, sizeof(DFA));
+	pthread_setspecific(dfakey, d);
+    }
+    if (d->generation != generation || d->full == YES) {
+	dfareset(d);
+    }
+    return(d);
+}
+
+static void
+dfakeyinit(void)
+{
+    pthread_key_create(&dfakey, dfafree);
+}
+
+static void
+dfafree(void *p)
+{
+    DFA	*d = p;
+
+    free(d->next);
+    free(d->set);
+    free(d->accept);
+    free(d->sets);
+    free(d->hash);
+    free(d);
+}
+
+/* empty a cache, and put the start state in it */
+
+static void
+dfareset(DFA *d)
+{
+    unsigned int i;
+    int	n = 0;
+
+    d->generation = generation;
+    d->full = NO;
+    d->nstates = 0;
+    d->nsets = 0;
+    if (d->hash == NULL) {
+	d->hsize = 256;
+	d->hash = mymalloc(d->hsize * sizeof(int));
+    }
+    memset(d->hash, -1, d->hsize * sizeof(int));
+    for (i = 3; i <= line; i++) {
+	if (initstat[i] == 1) {
+	    d->list[n++] = i;
+	}
+    }
+    (void) dfaadd(d, n, -1);
+}
+
+static unsigned int
+dfahash(int *list, int n)
+{
+    unsigned int h = 2166136261u;
+    int	i;
+
+    for (i = 0; i < n; i++) {
+	h = (h ^ list[i]) * 16777619u;
+    }
+    return(h);
+}
+
+/* add the set in the list as a state, or if the cache is full, as the
+   uncached state in the slot; returns the state */
+
+static int
+dfaadd(DFA *d, int n, int slot)
+{
+    long	size;
+    int	s, i, h;
+
+    size = (d->nstates + 3) * (ncls * sizeof(int) + sizeof(int) + 1) +
+	(d->nsets + n + 1 + 2 * (MAXLIN + 1)) * sizeof(int) +
+	d->hsize * sizeof(int);
+    if (slot >= 0 && size > DFAMEM) {
+	d->full = YES;
+    }
+    s = (d->full == YES) ? d->nstates + slot : d->nstates;
+
+    /* room for the state, and the two uncached ones after it */
+    if (s + 2 >= d->mstates) {
+	d->mstates = (d->mstates == 0) ? 64 : 2 * d->mstates;
+	d->next = myrealloc(d->next, d->mstates * ncls * sizeof(int));
+	d->set = myrealloc(d->set, d->mstates * sizeof(int));
+	d->accept = myrealloc(d->accept, d->mstates);
+    }
+    if (d->nsets + n + 1 + 2 * (MAXLIN + 1) > d->msets) {
+	d->msets = 2 * d->msets + n + 1 + 2 * (MAXLIN + 1);
+	d->sets = myrealloc(d->sets, d->msets * sizeof(int));
+    }
+    memset(d->next + s * ncls, -1, ncls * sizeof(int));
+    d->set[s] = (d->full == YES) ? d->nsets + slot * (MAXLIN + 1) : d->nsets;
+    d->sets[d->set[s]] = n;
+    memcpy(d->sets + d->set[s] + 1, d->list, n * sizeof(int));
+    d->accept[s] = (n > 0 && d->list[n - 1] == (int) line);
+    if (d->full == YES) {
+	return(s);
+    }
+    d->nsets += n + 1;
+    ++d->nstates;
+
+    /* keep the hash table at most half full */
+    if (2 * d->nstates > d->hsize) {
+	d->hsize *= 2;
+	d->hash = myrealloc(d->hash, d->hsize * sizeof(int));
+	memset(d->hash, -1, d->hsize * sizeof(int));
+	for (i = 0; i < d->nstates; i++) {
+	    h = dfahash(d->sets + d->set[i] + 1, d->sets[d->set[i]]);
+	    while (d->hash[h & (d->hsize - 1)] >= 0)
+		h++;
+	    d->hash[h & (d->hsize - 1)] = i;
+	}
+    } else {
+	h = dfahash(d->list, n);
+	while (d->hash[h & (d->hsize - 1)] >= 0)
+	    h++;
+	d->hash[h & (d->hsize - 1)] = s;
+    }
+    return(s);
+}
+
+/* make the next state from a state on a character class, and keep the
+   transition if both states are kept; returns the DFASTATE */
+
+static int
+dfanext(DFA *d, int v, int k)
+{
+    int	*set, *p, *end;
+    unsigned int i, num, newpos;
+    int	c, x, n, s, t, h;
+    BOOL	symbol = NO;
+
+    s = ((v < 0) ? -2 - v : v) / ncls;
+    c = classchar[k];
+    set = d->sets + d->set[s];
+    end = set + 1 + set[0];
+    ++d->stamp;
+    for (i = 3; i <= line; i++) {
+	if (initstat[i] == 1) {
+	    d->mark[i] = d->stamp;
+	}
+    }
+    for (p = set + 1; p < end; p++) {
+	if ((x = name[*p]) < 0) {
+	    continue;
+	}
+	/* a newline only leaves the start state for a position that names
+	   it, but then the others take it too */
+	if (x == c
+	    || (x == CCL && member(c, right[*p], 1))
+	    || (c != '\n' && (x == DOT
+			       || (x == NCCL && member(c, right[*p], 0))))) {
+	    symbol = YES;
+	} else if (!(x == DOT || (x == NCCL && member(c, right[*p], 0)))) {
+	    continue;
+	}
+	num = positions[foll[*p]];
+	newpos = foll[*p] + 1;
+	for (i = 0; i < num; i++) {
+	    d->mark[positions[newpos++]] = d->stamp;
+	}
+    }
+    if (symbol == NO) {
+	t = 0;
+    } else {
+	n = 0;
+	for (i = 3; i <= line; i++) {
+	    if (d->mark[i] == d->stamp) {
+		d->list[n++] = i;
+	    }
+	}
+	/* find the state, or add it */
+	h = dfahash(d->list, n);
+	while ((t = d->hash[h & (d->hsize - 1)]) >= 0) {
+	    if (d->sets[d->set[t]] == n &&
+		memcmp(d->sets + d->set[t] + 1, d->list, n * sizeof(int)) == 0) {
+		break;
+	    }
+	    h++;
+	}
+	if (t < 0) {
+	    t = dfaadd(d, n, (s == d->nstates) ? 1 : 0);
+	}
+    }
+    if (s < d->nstates && t < d->nstates) {
+	d->next[s * ncls + k] = DFASTATE(d, t);
+    }
+    return(DFASTATE(d, t));
+}
+
+/* the state at the start of a line, which has matched if the pattern
+   matches an empty string, and so is not a row to index */
+
+static int
+dfastart(DFA *d)
+{
+    int	k = cls['\n'];
+
+    if (d->accept[0] || d->next[k] == -1) {
+	return(dfanext(d, DFASTATE(d, 0), k));
+    }
+    return(d->next[k]);
+}
+
 int
-egrep(char *file, FILE *output, char *format)
+egrep(char *file, output_buffer_t *output, char *format)
 {
+    LINEPOS lp;
+    DFA *dfa;
+    int *rows;
+    unsigned char *map;
     char *p;
-    unsigned int cstat;
-    int ccount;
+    long cstat, istat;
+    int ccount, t;
     char buf[2*BUFSIZ];
     char *nlp;
-    unsigned int istat;
     int in_line;
     FILE *fptr;
 
     if ((fptr = myfopen(file, "r")) == NULL) 
 	return(-1);
 
+    if (factor != NULL) {
+	factorscan(fptr, file, output, format);
+	fclose(fptr);
+	return(0);
+    }
     ccount = 0;
-    lnum = 1;
+    lp.lnum = 1;
+    lp.counted = -1;
+    lp.bufbase = 0;
     in_line = 0;
     p = buf;
     nlp = p;
     if ((ccount = fread(p, sizeof(char), BUFSIZ, fptr)) <= 0)
 	goto done;
     in_line = 1;
-    istat = cstat = (unsigned int) gotofn[0]['\n'];
-    if (out[cstat])
+    dfa = dfaget();
+    map = iflag ? lcls : cls;	/* for -i option */
+    istat = cstat = dfastart(dfa);
+    rows = dfa->next;
+    if (ACCEPT(cstat))
 	goto found;
     for (;;) {
-	if (!iflag)
-	    cstat = (unsigned int) gotofn[cstat][(unsigned int)*p&0377];
+	cstat = NEXT(dfa, rows, cstat, map[(unsigned int)*p&0377], t);
 	/* all input chars made positive */
-	else
-	    cstat = (unsigned int) gotofn[cstat][tolower((int)*p&0377)];
-	/* for -i option*/
-	if (out[cstat]) {
+	if (ACCEPT(cstat)) {
 	found:
 	    for(;;) {
 		if (*p++ == '\n') {
 		    in_line = 0;
 		succeed:
-		    fprintf(output, format, file, lnum);
-		    if (p <= nlp) {
-			while (nlp < &buf[2*BUFSIZ])
-			    putc(*nlp++, output);
-			nlp = buf;
-		    }
-		    while (nlp < p)
-			putc(*nlp++, output);
-		    lnum++;
+		    lineat(fptr, buf, p, &lp, BUFINDEX(nlp));
+		    bm_search_out_head(output, format, file, lp.lnum);
+		    putline(output, buf, nlp, p);
 		    nlp = p;
-		    if ((out[(cstat=istat)]) == 0)
+		    if (ACCEPT(cstat=istat) == 0)
 			goto brk2;
 		} /* if (p++ == \n) */
 	    cfound:
 		if (--ccount <= 0) {
+		    if (lp.counted >= 0) {
+			lineat(fptr, buf, p, &lp, BUFINDEX(p));
+		    }
 		    if (p <= &buf[BUFSIZ]) {
 			ccount = fread(p, sizeof(char), BUFSIZ, fptr);
 		    } else if (p == &buf[2*BUFSIZ]) {
 			p = buf;
+			lp.bufbase += 2*BUFSIZ;
 			ccount = fread(p, sizeof(char), BUFSIZ, fptr);
 		    } else {
 			ccount = fread(p, sizeof(char), &buf[2*BUFSIZ] - p,
@@ -624,21 +1023,24 @@ egrep(char *file, FILE *output, char *format)
 		} /* if(ccount <= 0) */
 		in_line = 1;
 	    } /* for(ever) */
-	} /* if(out[cstat]) */
+	} /* if(ACCEPT(cstat)) */
 
 	if (*p++ == '\n') {
 	    in_line = 0;
-	    lnum++;
 	    nlp = p;
-	    if (out[(cstat=istat)])
+	    if (ACCEPT(cstat=istat))
 		goto cfound;
 	}
     brk2:
 	if (--ccount <= 0) {
+	    if (lp.counted >= 0) {
+		lineat(fptr, buf, p, &lp, BUFINDEX(p));
+	    }
 	    if (p <= &buf[BUFSIZ]) {
 		ccount = fread(p, sizeof(char), BUFSIZ, fptr);
 	    } else if (p == &buf[2*BUFSIZ]) {
 		p = buf;
+		lp.bufbase += 2*BUFSIZ;
 		ccount = fread(p, sizeof(char), BUFSIZ, fptr);
 	    } else {
 		ccount = fread(p, sizeof(char), &buf[2*BUFSIZ] - p, fptr);
@@ -653,6 +1055,160 @@ done:
     return(0);
 }
 
+/* search a file for the lines with the factor, and run the automaton on
+   them; the blocks read end at a newline, so the line numbers of the rest
+   of the file are counted as they are searched */
+
+static void
+factorscan(FILE *fptr, char *file, output_buffer_t *output, char *format)
+{
+    DFA *dfa;
+    int *rows;
+    unsigned char *map;
+    char *buf, *end, *p, *q, *from, *to, *counted, *s;
+    long size, have, n, lnum, bytes, scanned;
+    long cstat, istat;
+    int t;
+    BOOL eof = NO;
+
+    size = FACTORBUF;
+    buf = mymalloc(size);
+    have = 0;
+    lnum = 1;
+    bytes = scanned = 0;
+    dfa = dfaget();
+    map = iflag ? lcls : cls;	/* for -i option */
+    s = iflag ? lfactor : factor;
+    istat = dfastart(dfa);
+    rows = dfa->next;
+    while (eof == NO) {
+	if (have == size) {
+	    /* a line longer than the buffer */
+	    size *= 2;
+	    buf = myrealloc(buf, size);
+	}
+	if ((n = fread(buf + have, sizeof(char), size - have, fptr)) <= 0) {
+	    eof = YES;
+	} else {
+	    have += n;
+	    bytes += n;
+	}
+	/* the whole lines read, or at the end of the file, all of them */
+	end = buf + have;
+	if (eof == NO) {
+	    while (end > buf && end[-1] != '\n') {
+		--end;
+	    }
+	    if (end == buf) {
+		continue;
+	    }
+	}
+	counted = buf;
+	for (q = buf; (p = bm_search_find(q, end - q, s, factorlen, iflag)) != NULL;
+	     q = to) {
+	    for (from = p; from > q && from[-1] != '\n'; --from) {
+		;
+	    }
+	    if ((to = memchr(p, '\n', end - p)) != NULL) {
+		++to;
+	    } else {
+		to = end;
+	    }
+	    scanned += to - from;
+	    cstat = istat;
+	    for (p = from; !ACCEPT(cstat) && p < to; ++p) {
+		cstat = NEXT(dfa, rows, cstat, map[(unsigned char) *p], t);
+	    }
+	    if (ACCEPT(cstat)) {
+		lnum += bm_search_count_lines(counted, from);
+		counted = from;
+		bm_search_out_head(output, format, file, lnum);
+		bm_search_out_text(output, from, to - from);
+	    }
+	}
+	if (eof == NO) {
+	    lnum += bm_search_count_lines(counted, end);
+	}
+	have -= end - buf;
+	memmove(buf, end, have);
+    }
+    free(buf);
+
+    pthread_mutex_lock(&statlock);
+    ++nfiles;
+    if (scanned == 0) {
+	++nfileskips;
+    }
+    nbytes += bytes;
+    nscanned += scanned;
+    pthread_mutex_unlock(&statlock);
+}
+
+/* put the line from one position in the buffer to another, which may wrap
+   around it, in the output */
+
+static void
+putline(output_buffer_t *output, char *buf, char *from, char *to)
+{
+    if (to <= from) {
+	bm_search_out_text(output, from, &buf[2*BUFSIZ] - from);
+	from = buf;
+    }
+    bm_search_out_text(output, from, to - from);
+}
+
+/* Line numbers are only counted in files with a match.  The newlines
+   before the first match are counted by reading the file again from its
+   start, since the buffer only keeps the last of it.  From then on the
+   newlines are counted as the buffer is refilled, so the ones not yet
+   counted are still in it. */
+
+static void
+lineat(FILE *fptr, char *buf, char *p, LINEPOS *lp, long to)
+{
+    char	tmp[BUFSIZ];
+    long	pos, done;
+    int	n;
+
+    if (lp->counted < 0 && lp->bufbase == 0) {
+	/* nothing of the file has been overwritten yet */
+	lp->lnum = 1 + bm_search_count_lines(buf, buf + to);
+	lp->counted = to;
+	return;
+    }
+    if (lp->counted < 0) {
+	lp->lnum = 1;
+	if ((pos = ftell(fptr)) != -1) {
+	    rewind(fptr);
+	    for (done = 0; done < to; done += n) {
+		n = (to - done < BUFSIZ) ? to - done : BUFSIZ;
+		if ((n = fread(tmp, sizeof(char), n, fptr)) <= 0) {
+		    break;
+		}
+		lp->lnum += bm_search_count_lines(tmp, tmp + n);
+	    }
+	    fseek(fptr, pos, SEEK_SET);
+	}
+	lp->counted = to;
+	return;
+    }
+    if (to <= lp->counted) {
+	/* still on the line numbered */
+	return;
+    }
+    /* the newlines since the line numbered, which may wrap around the
+       buffer */
+    if (lp->counted < lp->bufbase) {
+	lp->lnum += bm_search_count_lines(buf + 2*BUFSIZ -
+					  (lp->bufbase - lp->counted),
+					  buf + 2*BUFSIZ);
+	lp->counted = lp->bufbase;
+    }
+    lp->lnum += bm_search_count_lines(buf + (lp->counted - lp->bufbase),
+				      buf + (to - lp->bufbase));
+    lp->counted = to;
+}
+
 /* FIXME HBB: should export this to a separate file and use
  * AC_REPLACE_FUNCS() */
 #if !STDC_HEADERS && !defined(HAVE_MEMSET) && !defined(HAVE_MEMORY_H)
@@ -677,3 +1233,18 @@ egrepcaseless(int i)
 {
 	iflag = i;	/* simulate "egrep -i" */
 }
+
+/* the factor of the pattern, or NULL if it has none, and how many files
+   and how much text it has let the searches since egrepinit() skip */
+
+char *
+egrepskips(long *files, long *fileskips, long *bytes, long *byteskips)
+{
+    pthread_mutex_lock(&statlock);
+    *files = nfiles;
+    *fileskips = nfileskips;
+    *bytes = nbytes;
+    *byteskips = nbytes - nscanned;
+    pthread_mutex_unlock(&statlock);
+    return(factor);
+}
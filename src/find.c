@@ -37,6 +37,7 @@
 
 #include "global.h"
 
+#include "alloc.h"
 #include "build.h"
 #include "scanner.h"		/* for token definitions */
 
@@ -77,8 +78,12 @@ static	BOOL	match(void);
 static	BOOL	matchrest(void);
 static	POSTING	*getposting(void);
 static	char	*lcasify(char *s);
+static	void	readreport(void);
 static	void	findcalledbysub(char *file, BOOL macro);
-static	void	findterm(char *pattern);
+static	long	findcallgraph(char *pattern, BOOL callers);
+static	void	putcallee(CGCONTROL *cg, long fcn, CGEDGE *e, void *arg);
+static	void	putcaller(CGCONTROL *cg, long fcn, CGEDGE *e, void *arg);
+static	void	findterm(char *pattern, int parts);
 static	void	putline(FILE *output);
 static  char    *find_symbol_or_assignment(char *pattern, BOOL assign_flag);
 static  BOOL    check_for_assignment(void);
@@ -122,6 +127,41 @@ check_for_assignment(void)
 		return NO;
 	}
     }
+    return isassignment(asgn_char);
+}
+
+/* Same test for the symbol just fetched by copyinverted(), which must
+ * not lose the rest of the current block, so look ahead in the file
+ * instead of reading the next block */
+BOOL
+peekassignment(void)
+{
+    char    text[16];
+    char    *cp;
+    int	    i, n;
+
+    i = 0;
+    for (cp = blockp; cp < block + blocklen && i < sizeof(text) - 1; ++cp) {
+	text[i++] = *cp;
+    }
+    if (i < sizeof(text) - 1 &&
+	(n = read(symrefs, text + i, sizeof(text) - 1 - i)) > 0) {
+	lseek(symrefs, -n, SEEK_CUR);
+	i += n;
+    }
+    text[i] = '\0';
+    return isassignment(text);
+}
+
+/* Test whether the text following a symbol assigns to it.  This works
+ * on both source text and database text, where the operator may be
+ * compressed into a digraph */
+BOOL
+isassignment(char *asgn_char)
+{
+    while (isspace((unsigned char) asgn_char[0])) {
+	asgn_char++;
+    }
     /* check for digraph starting with = */
     if ((asgn_char[0] & 0x80) && (dichar1[(asgn_char[0] & 0177)/8] == '=')) {
 	return YES;
@@ -175,13 +215,20 @@ find_symbol_or_assignment(char *pattern, BOOL assign_flag)
 	char firstchar;		/* first character of a potential symbol */
 	BOOL fcndef = NO;
 
-	if ((invertedindex == YES) && (assign_flag == NO)) {
+	if (invertedindex == YES) {
 		long	lastline = 0;
 		POSTING *p;
 
-		findterm(pattern);
+		/* assignments to other symbols have a partition of their own,
+		   definitions with an initializer are flagged in theirs */
+		if (assign_flag == YES) {
+			findterm(pattern, PARTMASK(PARTDEF) | PARTMASK(PARTASSIGN));
+		} else {
+			findterm(pattern, PARTALL & ~PARTMASK(PARTINCL));
+		}
 		while ((p = getposting()) != NULL) {
-			if (p->type != INCLUDE && p->lineoffset != lastline) {
+			if (p->type != INCLUDE && p->lineoffset != lastline &&
+			    (assign_flag == NO || p->assign)) {
 				putpostingref(p, 0);
 				lastline = p->lineoffset;
 			}
@@ -368,7 +415,7 @@ finddef(char *pattern)
 	if (invertedindex == YES) {
 		POSTING *p;
 
-		findterm(pattern);
+		findterm(pattern, PARTMASK(PARTDEF));
 		while ((p = getposting()) != NULL) {
 			switch (p->type) {
 			case DEFINE:/* could be a macro */
@@ -473,10 +520,14 @@ findcalling(char *pattern)
 	char	*tmpblockp;
 	int	morefuns, i;
 
+	if (calldepth != 1 && cgcontrol.header != NULL) {
+		(void) findcallgraph(pattern, YES);
+		return NULL;
+	}
 	if (invertedindex == YES) {
 		POSTING	*p;
 		
-		findterm(pattern);
+		findterm(pattern, PARTMASK(PARTCALL));
 		while ((p = getposting()) != NULL) {
 			if (p->type == FCNCALL) {
 				putpostingref(p, 0);
@@ -574,46 +625,37 @@ findstring_bmsearch( char * pattern )
     return(egreperror);
 }
 
-/* find the text in the source files with boyer moore search algorithm
- * with multi thread.
- */
-
 static char *
-bmsearch_multithread( char * pattern )
+bmsearch_multithread2( char * pattern )
 {
     unsigned int i;
     char *error = "Invalid search!";
 
-	bm_search_worker_init( refsfound, "%s <text> %ld ", pattern, nsrcfiles );
+	bm_search_worker_init( refsfound, "%s <text> %ld ", pattern, caseless );
 
-	/* add files into workers. */
-	for (i = 0; i < nsrcfiles; ++i) {
-		bm_search_worker_add( i, srcfiles[i] );
-	}
 	/* run the threads to find the pattern */
-	if ( bm_search_and_output_worker_run() ) {
+	if ( bm_search_and_output_global_worker_run( srcfiles, nsrcfiles ) ) {
 		posterr( "Failed to start search workers!" );
 	}
+	readreport();
 
 	bm_search_worker_deinit();
     return(error);
 }
 
-static char *
-bmsearch_multithread2( char * pattern )
-{
-    unsigned int i;
-    char *error = "Invalid search!";
+/* tell how the text search read the files, in verbose mode */
 
-	bm_search_worker_init( refsfound, "%s <text> %ld ", pattern, nsrcfiles );
+static void
+readreport(void)
+{
+	char	msg[MSGLEN + 1];
 
-	/* run the threads to find the pattern */
-	if ( bm_search_and_output_global_worker_run( srcfiles, nsrcfiles ) ) {
-		posterr( "Failed to start search workers!" );
+	if (verbosemode == YES) {
+		bm_search_read_report(msg, sizeof(msg));
+		if (*msg != '\0') {
+			postmsg(msg);
+		}
 	}
-
-	bm_search_worker_deinit();
-    return(error);
 }
 
 char *
@@ -622,6 +664,72 @@ findstring_bmsearch_multithread( char * pattern )
 	return bmsearch_multithread2( pattern );
 }
 
+/* find any of the text strings, separated by |, or listed one to a line
+   in the file named after an @, with one pass over each source file; the
+   errors are reported here, since they are not in an egrep pattern */
+
+char *
+findmulti(char *pattern)
+{
+	FILE	*fp;
+	char	**needles;
+	char	*text, *s, *sep;
+	long	size;
+	int	count;
+	int	rc;
+
+	/* get the strings */
+	if (*pattern == '@') {
+		if ((fp = myfopen(pattern + 1, "rb")) == NULL) {
+			cannotopen(pattern + 1);
+			return(NULL);
+		}
+		if (fseek(fp, 0L, SEEK_END) == -1 || (size = ftell(fp)) == -1 ||
+		    fseek(fp, 0L, SEEK_SET) == -1) {
+			posterr("cscope: cannot read file %s", pattern + 1);
+			fclose(fp);
+			return(NULL);
+		}
+		text = mymalloc(size + 1);
+		size = fread(text, 1, size, fp);
+		text[size] = '\0';
+		fclose(fp);
+		sep = "\n";
+	} else {
+		text = my_strdup(pattern);
+		sep = "|";
+	}
+	count = 1;
+	for (s = text; (s = strpbrk(s, sep)) != NULL; ++s) {
+		++count;
+	}
+	needles = mymalloc(count * sizeof(char *));
+	count = 0;
+	for (s = text; s != NULL; ) {
+		needles[count++] = s;
+		if ((s = strpbrk(s, sep)) != NULL) {
+			*s++ = '\0';
+		}
+	}
+	if (*pattern == '@') {
+		for (rc = 0; rc < count; ++rc) {
+			if ((s = strchr(needles[rc], '\r')) != NULL) {
+				*s = '\0';
+			}
+		}
+	}
+	/* search the source files */
+	rc = bm_search_multi(srcfiles, nsrcfiles, refsfound, "%s %s %ld ",
+			     needles, count, caseless);
+	readreport();
+	free(needles);
+	free(text);
+	if (rc < 0) {
+		posterr("cscope: no strings to find in %s", pattern);
+	}
+	return(NULL);
+}
+
 /* find the text in the source files */
 
 char *
@@ -644,26 +752,34 @@ findstring(char *pattern)
 	return(findregexp(egreppat));
 }
 
+/* search a source file for the compiled regular expression */
+
+static int
+findregexpfile(char *file, output_buffer_t *out)
+{
+	return(egrep(file, out, "%s <unknown> %ld "));
+}
+
 /* find this regular expression in the source files */
 
 char *
 findregexp(char *egreppat)
 {
-    unsigned int i;
     char *egreperror;
-	char path[PATHLEN + 1];
+    char *factor;
+    char msg[MSGLEN + 1];
+    long files, fileskips, bytes, byteskips;
 
-    /* compile the pattern */
+    /* compile the pattern, and search the files on the pool with it */
     if ((egreperror = egrepinit(egreppat)) == NULL) {
-
-	/* search the files */
-	for (i = 0; i < nsrcfiles; ++i) {
-	    char *file = filepath(srcfiles[i], path, PATHLEN + 1);
-
-	    progress("Search", searchcount, nsrcfiles);
-	    if (egrep(file, refsfound, "%s <unknown> %ld ") < 0) {
-		posterr ("Cannot open file %s", file);
-	    }
+	bm_search_ordered_run(srcfiles, nsrcfiles, refsfound, findregexpfile);
+	factor = egrepskips(&files, &fileskips, &bytes, &byteskips);
+	if (verbosemode == YES && factor != NULL && files > 0) {
+	    snprintf(msg, sizeof(msg),
+		     "cscope: \"%s\" skipped %ld of %ld files, %.1f%% of the text",
+		     factor, fileskips, files,
+		     (bytes > 0) ? 100.0 * byteskips / bytes : 100.0);
+	    postmsg(msg);
 	}
     }
     return(egreperror);
@@ -705,7 +821,7 @@ findinclude(char *pattern)
 	if (invertedindex == YES) {
 		POSTING *p;
 
-		findterm(pattern);
+		findterm(pattern, PARTMASK(PARTINCL));
 		while ((p = getposting()) != NULL) {
 			if (p->type == INCLUDE) {
 				putpostingref(p, 0);
@@ -1140,10 +1256,14 @@ findcalledby(char *pattern)
 	static char found_caller = 'n'; /* seen calling function? */
 	BOOL	macro = NO;
 
+	if (calldepth != 1 && cgcontrol.header != NULL) {
+		found_caller = findcallgraph(pattern, NO) > 0 ? 'y' : 'n';
+		return(&found_caller);
+	}
 	if (invertedindex == YES) {
 		POSTING	*p;
 		
-		findterm(pattern);
+		findterm(pattern, PARTMASK(PARTDEF));
 		while ((p = getposting()) != NULL) {
 			switch (p->type) {
 			case DEFINE:		/* could be a macro */
@@ -1190,10 +1310,71 @@ findcalledby(char *pattern)
 	return (&found_caller);
 }
 
-/* find this term, which can be a regular expression */
+/* find the callers or callees of the matching functions, and theirs, up
+   to calldepth levels away */
+
+static long
+findcallgraph(char *pattern, BOOL callers)
+{
+	long	*roots;		/* matching functions */
+	long	nroots = 0;
+	long	i, n;
+	char	*s;
+
+	n = cgcontrol.header->nfcns;
+	roots = mymalloc((n + 1) * sizeof(long));
+	if (caseless == NO && strpbrk(pattern, ".[{*+") == NULL) {
+		if ((i = cgfind(&cgcontrol, pattern)) >= 0) {
+			roots[nroots++] = i;
+		}
+	} else if (isregexp_valid == YES) {
+		for (i = 0; i < n; ++i) {
+			s = cgfcnname(&cgcontrol, i);
+			if (caseless == YES) {
+				s = lcasify(s);
+			}
+			if (regexec(&regexp, s, (size_t)0, NULL, 0) == 0) {
+				roots[nroots++] = i;
+			}
+		}
+	}
+	cgwalk(&cgcontrol, roots, nroots, callers, calldepth,
+	       callers == YES ? putcaller : putcallee, NULL);
+	free(roots);
+	return(nroots);
+}
+
+/* put a call found in the call graph into the file */
+
+static void
+putcaller(CGCONTROL *cg, long fcn, CGEDGE *e, void *arg)
+{
+	(void) fcn;		/* unused arguments */
+	(void) arg;
+
+	if (dbseek(e->offset) != -1) {
+		putref(0, cgfilename(cg, e->file), cgfcnname(cg, e->fcn));
+	}
+}
+
+static void
+putcallee(CGCONTROL *cg, long fcn, CGEDGE *e, void *arg)
+{
+	(void) fcn;		/* unused arguments */
+	(void) arg;
+
+	if (dbseek(e->offset) != -1) {
+		(void) fprintf(refsfound, "%s %s ", cgfilename(cg, e->file),
+			       cgfcnname(cg, e->fcn));
+		putsource(1, refsfound);
+	}
+}
+
+/* find this term, which can be a regular expression, and collect its
+   postings in the partitions selected by the 'parts' mask */
 
 static void
-findterm(char *pattern)
+findterm(char *pattern, int parts)
 {
 	char	*s;
 	int	len;
@@ -1241,7 +1422,7 @@ findterm(char *pattern)
 		if (regexec (&regexp, s, (size_t)0, NULL, 0) == 0) {
 	
 			/* add its postings to the set */
-			if ((postingp = boolfile(&invcontrol, &npostings, BOOL_OR)) == NULL) {
+			if ((postingp = boolfile(&invcontrol, &npostings, BOOL_OR, parts)) == NULL) {
 				break;
 			}
 		}
@@ -1293,10 +1474,17 @@ static void
 putpostingref(POSTING *p, char *pat)
 {
 	static char	function[PATLEN + 1];	/* function name */
+	CGDEF	*d;
 
+	/* the call graph index maps definitions to names, so the database
+	   only has to be read for the source line */
 	if (p->fcnoffset == 0) {
 		if (p->type == FCNDEF) { /* need to find the function name */
-			if (dbseek(p->lineoffset) != -1) {
+			if ((d = cgdef(&cgcontrol, p->lineoffset)) != NULL &&
+			    d->type == FCNDEF) {
+				strcpy(function, cgfcnname(&cgcontrol, d->fcn));
+			}
+			else if (dbseek(p->lineoffset) != -1) {
 				scanpast(FCNDEF);
 				fetch_string_from_dbase(function,
 							sizeof(function));
@@ -1307,7 +1495,12 @@ putpostingref(POSTING *p, char *pat)
 		}
 	}
 	else if (p->fcnoffset != lastfcnoffset) {
-		if (dbseek(p->fcnoffset) != -1) {
+		if ((d = cgdef(&cgcontrol, p->fcnoffset)) != NULL &&
+		    d->offset == p->fcnoffset) {
+			strcpy(function, cgfcnname(&cgcontrol, d->fcn));
+			lastfcnoffset = p->fcnoffset;
+		}
+		else if (dbseek(p->fcnoffset) != -1) {
 			fetch_string_from_dbase(function, sizeof(function));
 			lastfcnoffset = p->fcnoffset;
 		}
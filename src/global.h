@@ -80,6 +80,7 @@ char	*memset();
 #include "constants.h"	/* misc. constants */
 #include "invlib.h"	/* inverted index library */
 #include "library.h"	/* library function return values */
+#include "pathtrie.h"	/* source file path trie */
 
 /* Fallback, in case 'configure' failed to do its part of the job */
 #ifndef RETSIGTYPE
@@ -241,6 +242,7 @@ extern 	BOOL	lineflagafterfile;
 extern	char	*argv0;		/* command name */
 extern	BOOL	compress;	/* compress the characters in the crossref */
 extern	BOOL	dbtruncated;	/* database symbols truncated to 8 chars */
+extern	BOOL	partialdb;	/* database has only some of the files */
 extern	int	dispcomponents;	/* file path components to display */
 #if CCS
 extern	BOOL	displayversion;	/* display the C Compilation System version */
@@ -266,6 +268,8 @@ extern	long	totalterms;	/* total inverted index terms */
 extern	BOOL	trun_syms;	/* truncate symbols to 8 characters */
 extern	char	tempstring[TEMPSTRING_LEN + 1]; /* global dummy string buffer */
 extern	char	*tmpdir;	/* temporary directory */
+extern	int	calldepth;	/* levels of callers/callees to find */
+extern	int	thread_worker_count;	/* worker threads to use */
 
 /* command.c global data */
 extern	BOOL	caseless;	/* ignore letter case when searching */
@@ -277,7 +281,6 @@ extern	char	newpat[];	/* new pattern */
 extern	char	Pattern[];	/* symbol or text pattern */
 
 /* crossref.c global data */
-extern	long	dboffset;	/* new database offset */
 extern	BOOL	errorsfound;	/* prompt before clearing error messages */
 extern	long	lineoffset;	/* source line database offset */
 extern	long	npostings;	/* number of postings */
@@ -288,6 +291,7 @@ extern	char	currentdir[];	/* current directory */
 extern	char	**incdirs;	/* #include directories */
 extern	char	**srcdirs;	/* source directories */
 extern	char	**srcfiles;	/* source files */
+extern	PATHTRIE srctrie;	/* source file paths */
 extern	unsigned long nincdirs;	/* number of #include directories */
 extern	unsigned long nsrcdirs;	/* number of source directories */
 extern	unsigned long nsrcfiles; /* number of source files */
@@ -345,6 +349,7 @@ char	*findallfcns(char *dummy);
 char	*finddef(char *pattern);
 char	*findfile(char *dummy);
 char	*findinclude(char *pattern);
+char	*findmulti(char *pattern);
 char	*findsymbol(char *pattern);
 char	*findassign(char *pattern);
 char	*findregexp(char *egreppat);
@@ -369,6 +374,7 @@ void	cannotopen(char *file);
 void	clearmsg(void);
 void	clearmsg2(void);
 void	countrefs(void);
+int	crossinput(char *buf, int size);
 void	crossref(char *srcfile);
 void    dispinit(void);
 void	display(void);
@@ -401,7 +407,7 @@ void	postmsg(char *msg);
 void	postmsg2(char *msg);
 void	posterr(char *msg,...);
 void	postfatal(const char *msg,...);
-void	putposting(char *term, int type);
+void	putposting(char *term, int type, BOOL assign);
 void	fetch_string_from_dbase(char *, size_t);
 void	resetcmd(void);
 void	seekline(unsigned int line);
@@ -414,6 +420,8 @@ void	writestring(char *s);
 
 BOOL	command(int commandc);
 BOOL	infilelist(char *file);
+BOOL	isassignment(char *asgn_char);
+BOOL	peekassignment(void);
 BOOL	readrefs(char *filename);
 BOOL	search(void);
 BOOL	writerefsfound(void);
@@ -424,7 +432,6 @@ struct	cmd *currentcmd(void);
 struct	cmd *prevcmd(void);
 struct	cmd *nextcmd(void);
 
-int	egrep(char *file, FILE *output, char *format);
 int	mygetline(char p[], char s[], unsigned size, int firstchar, BOOL iscaseless);
 int	mygetch(void);
 int	hash(char *ss);
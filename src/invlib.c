@@ -42,20 +42,47 @@
 #endif
 #include "invlib.h"
 #include "global.h"
+#include "scanner.h"		/* for the reference type mark characters */
+#include "pool.h"
 
 #include <assert.h>
+#include <pthread.h>
 
+#define	CHUNKSIZE	(256 * 1024)	/* sorted postings parsed as a job */
 #define	DEBUG		0	/* debugging code and realloc messages */
 #define BLOCKSIZE	2 * BUFSIZ	/* logical block size */
-#define	POSTINC		10000	/* posting buffer size increment */
+#define	MAXCHUNKS	16	/* most chunks read ahead */
 #define SEP		' '	/* sorted posting field separator */
 #define	SETINC		100	/* posting set size increment */
 #define	STATS		0	/* print statistics */
 #define	SUPERINC	10000	/* super index size increment */
 #define	TERMMAX		512	/* term max size */
-#define	FMTVERSION	1	/* inverted index format version */
+#define	FMTVERSION	3	/* inverted index format version */
 #define	ZIPFSIZE	200	/* zipf curve size */
 
+/* a term of a chunk, with its postings grouped by partition */
+typedef	struct {
+	char	*term;
+	unsigned npost;
+	long	counts[NPARTS];	/* postings in each partition */
+	long	first;		/* index of the first posting */
+} INVTERM;
+
+/* whole terms of the sorted postings, parsed by a worker and added to the
+   index in order by the reading thread */
+typedef	struct {
+	char	*text;		/* posting lines, each ended by a '\0' */
+	long	used, size;
+	long	nlines;
+	INVTERM	*terms;
+	long	nterms, mterms;
+	POSTING	*posts;		/* postings grouped by partition */
+	POSTING	*parsed;	/* postings in sorted order */
+	long	mposts;
+	int	done;		/* parsed, and ready to be added */
+	int	failed;		/* out of memory */
+} INVCHUNK;
+
 static char const rcsid[] = "$Id: invlib.c,v 1.20 2012/03/12 17:57:55 nhorman Exp $";
 
 #if DEBUG
@@ -66,11 +93,21 @@ int	invbreak;
 #endif
 
 static	int	boolready(void);
-static	int	invnewterm(void);
+static	int	invnewterm(POSTING *grouped, unsigned n, long *termcounts);
+static	int	invpart(POSTING *p);
+static	void	invgroup(POSTING *from, unsigned n, long *counts, POSTING *to);
+static	void	invchunk(INVCHUNK *c);
+static	int	invstart(void);
+static	int	invstitch(INVCHUNK *c);
+static	INVCHUNK *invsubmit(void);
+static	int	invstop(void);
+static	void	invtask(void *arg);
+static	int	postcmp(POSTING *p1, POSTING *p2);
 static	void	invstep(INVCONTROL *invcntl);
 static	void	invcannotalloc(unsigned n);
 static	void	invcannotopen(char *file);
 static	void	invcannotwrite(char *file);
+static	char	*invgetline(char *line, int size, void *infile);
 
 #if STATS
 int	showzipf;	/* show postings per term distribution */
@@ -84,7 +121,8 @@ static	FILE	*outfile, *fpost;
 static	unsigned supersize = SUPERINC, supintsize;
 static  unsigned int numpost, numlogblk, amtused, nextpost;
 static  unsigned int lastinblk, numinvitems;
-static	POSTING	*POST, *postptr;
+static	POSTING	*runbuf;	/* partitions read by boolfile() */
+static	unsigned runsize;
 static	unsigned long	*SUPINT, *supint, nextsupfing;
 static	char	*SUPFING, *supfing;
 static	char	thisterm[TERMMAX];
@@ -93,6 +131,12 @@ typedef union logicalblk {
 	char	chrblk[BLOCKSIZE];
 } t_logicalblk;
 static t_logicalblk logicalblk;
+static	INVCHUNK *chunks;	/* used in turn */
+static	long	nchunks;
+static	unsigned long submitted, stitched;	/* chunk counts */
+static	POOLGROUP parsing;	/* chunks being parsed */
+static	pthread_mutex_t invlock = PTHREAD_MUTEX_INITIALIZER;
+static	pthread_cond_t invcond = PTHREAD_COND_INITIALIZER;
 
 #if DEBUG || STATS
 static	long	totpost;
@@ -102,284 +146,36 @@ static	long	totpost;
 static	int	zipf[ZIPFSIZE + 1];
 #endif
 
+/* make the inverted index from a file of sorted postings */
+
 long
 invmake(char *invname, char *invpost, FILE *infile)
 {
-	unsigned char	*s;
-	long	num;
-	int	i;
-	long	fileindex = 0;	/* initialze, to avoid warning */
-	unsigned postsize = POSTINC * sizeof(POSTING);
-	unsigned long	*intptr;
-	char	line[TERMMAX];
-	long	tlong;
-	PARAM	param;
-	POSTING	posting;
-	char 	temp[BLOCKSIZE];
-#if STATS
-	int	j;
-	unsigned maxtermlen = 0;
-#endif
-	/* output file */
-	if ((outfile = vpfopen(invname, "w+b")) == NULL) {
-		invcannotopen(invname);
-		return(0);
-	}
-	indexfile = invname;
-	fseek(outfile, BUFSIZ, SEEK_SET);
-
-	/* posting file  */
-	if ((fpost = vpfopen(invpost, "wb")) == NULL) {
-		invcannotopen(invpost);
-		return(0);
-	}
-	postingfile = invpost;
-	nextpost = 0;
-	/* get space for the postings list */
-	if ((POST = malloc(postsize)) == NULL) {
-		invcannotalloc(postsize);
-		return(0);
-	}
-	postptr = POST;
-	/* get space for the superfinger (superindex) */
-	if ((SUPFING = malloc(supersize)) == NULL) {
-		invcannotalloc(supersize);
-		return(0);
-	}
-	supfing = SUPFING;
-	/* FIXME HBB: magic number alert (40) */
-	supintsize = supersize / 40;
-	/* also for the superfinger index */
-	if ((SUPINT = malloc(supintsize * sizeof(long))) == NULL) {
-		invcannotalloc(supintsize * sizeof(long));
-		return(0);
-	}
-	supint = SUPINT;
-	supint++; /* leave first term open for a count */
-	/* initialize using an empty term */
-	strcpy(thisterm, "");
-	*supint++ = 0;
-	*supfing++ = ' ';
-	*supfing++ = '\0';
-	nextsupfing = 2;
-#if DEBUG || STATS
-	totpost = 0L;
-#endif
-	totterm = 0L;
-	numpost = 1;
-
-	/* set up as though a block had come and gone, i.e., set up for new block  */
-	/* FIXME HBB: magic number alert (16) */
-	amtused = 16; /* leave no space - init 3 words + one for luck */
-	numinvitems = 0;
-	numlogblk = 0;
-	lastinblk = sizeof(t_logicalblk);
-
-	/* now loop as long as more to read (till eof)  */
-	while (fgets(line, TERMMAX, infile) != NULL) {
-#if DEBUG || STATS
-		++totpost;
-#endif
-		s = strchr(line, SEP);
-		if (s != NULL) {
-			*s = '\0';
-		}
-		else {
-			continue;
-		}
-#if STATS
-		if ((i = strlen(line)) > maxtermlen) {
-			maxtermlen = i;
-		}
-#endif
-#if DEBUG
-		printf("%ld: %s ", totpost, line);
-		fflush(stdout);
-#endif
-		if (strcmp(thisterm, line) == 0) {
-			if (postptr + 10 > POST + postsize / sizeof(POSTING)) {
-				i = postptr - POST;
-				postsize += POSTINC * sizeof(POSTING);
-				if ((POST = realloc(POST, postsize)) == NULL) {
-					invcannotalloc(postsize);
-					return(0);
-				}
-				postptr = i + POST;
-#if DEBUG
-				printf("reallocated post space to %u, totpost=%ld\n",
-				       postsize, totpost);
-#endif
-			}
-			numpost++;
-		} else {
-			/* have a new term */
-			if (!invnewterm()) {
-				return(0);
-			}
-			strcpy(thisterm, line);
-			numpost = 1;
-			postptr = POST;
-			fileindex = 0;
-		}
-		/* get the new posting */
-		num = *++s - '!';
-		i = 1;
-		do {
-			num = BASE * num + *++s - '!';
-		} while (++i < PRECISION);
-		posting.lineoffset = num;
-		while (++fileindex < nsrcfiles && num > srcoffset[fileindex]) {
-			;
-		}
-		posting.fileindex = --fileindex;
-		posting.type = *++s;
-		++s;
-		if (*s != '\n') {
-			num = *++s - '!';
-			while (*++s != '\n') {
-				num = BASE * num + *s - '!';
-			}
-			posting.fcnoffset = num;
-		}
-		else {
-			posting.fcnoffset = 0;
-		}
-		*postptr++ = posting;
-#if DEBUG
-		printf("%ld %ld %ld %ld\n", posting.fileindex,
-		       posting.fcnoffset, posting.lineoffset, posting.type);
-		fflush(stdout);
-#endif
-	}
-	if (!invnewterm()) {
-		return(0);
-	}
-	/* now clean up final block  */
-	logicalblk.invblk[0] = numinvitems;
-	/* loops pointer around to start */
-	logicalblk.invblk[1] = 0;
-	logicalblk.invblk[2] = numlogblk - 1;
-	if (fwrite(&logicalblk, sizeof(t_logicalblk), 1, outfile) == 0) {
-		goto cannotwrite;
-	}
-	numlogblk++;
-	/* write out block to save space. what in it doesn't matter */
-	if (fwrite(&logicalblk, sizeof(t_logicalblk), 1, outfile) == 0) {
-		goto cannotwrite;
-	}
-	/* finish up the super finger */
-	*SUPINT = numlogblk;
-	/* add to the offsets the size of the offset pointers */
-	intptr = (SUPINT + 1);
-	i = (char *)supint - (char *)SUPINT;
-	while (intptr < supint)
-		*intptr++ += i;
-	/* write out the offsets (1 for the N at start) and the super finger */
-	if (fwrite(SUPINT, sizeof(*SUPINT), numlogblk + 1, outfile) == 0 ||
-	    fwrite(SUPFING, 1, supfing - SUPFING, outfile) == 0) {
-		goto cannotwrite;
-	}
-	/* save the size for reference later */
-	nextsupfing = sizeof(long) + sizeof(long) * numlogblk + (supfing - SUPFING);
-	/* make sure the file ends at a logical block boundary.  This is 
-	necessary for invinsert to correctly create extended blocks 
-	 */
-	i = nextsupfing % sizeof(t_logicalblk);
-	/* write out junk to fill log blk */
-	if (fwrite(temp, sizeof(t_logicalblk) - i, 1, outfile) == 0 ||
-	    fflush(outfile) == EOF) {	/* rewind doesn't check for write failure */
-		goto cannotwrite;
-	}
-	/* write the control area */
-	rewind(outfile);
-	param.version = FMTVERSION;
-	param.filestat = 0;
-	param.sizeblk = sizeof(t_logicalblk);
-	param.startbyte = (numlogblk + 1) * sizeof(t_logicalblk) + BUFSIZ;;
-	param.supsize = nextsupfing;
-	param.cntlsize = BUFSIZ;
-	param.share = 0;
-	if (fwrite(&param, sizeof(param), 1, outfile) == 0) {
-		goto cannotwrite;
-	}
-	for (i = 0; i < 10; i++)	/* for future use */
-		if (fwrite(&zerolong, sizeof(zerolong), 1, outfile) == 0) {
-			goto cannotwrite;
-		}
-
-	/* make first block loop backwards to last block */
-	if (fflush(outfile) == EOF) {	/* fseek doesn't check for write failure */
-		goto cannotwrite;
-	}
-	/* get to second word first block */
-	fseek(outfile, BUFSIZ + 2 * sizeof(long), SEEK_SET);
-	tlong = numlogblk - 1;
-	if (fwrite(&tlong, sizeof(tlong), 1, outfile) == 0 ||
-	    fclose(outfile) == EOF) {
-	cannotwrite:
-		invcannotwrite(invname);
-		return(0);
-	}
-	if (fclose(fpost) == EOF) {
-		invcannotwrite(postingfile);
-		return(0);
-	}
-	--totterm;	/* don't count null term */
-#if STATS
-	printf("logical blocks = %d, postings = %ld, terms = %ld, max term length = %d\n",
-	    numlogblk, totpost, totterm, maxtermlen);
-	if (showzipf) {
-		printf("\n*************   ZIPF curve  ****************\n");
-		for (j = ZIPFSIZE; j > 1; j--)
-			if (zipf[j]) 
-				break;
-		for (i = 1; i < j; ++i) {
-			printf("%3d -%6d ", i, zipf[i]);
-			if (i % 6 == 0) putchar('\n');
-		}
-		printf(">%d-%6d\n", ZIPFSIZE, zipf[0]);
-	}
-#endif
-	/* free all malloc'd memory */
-	free(POST);
-	free(SUPFING);
-	free(SUPINT);
-	return(totterm);
+	return(invmakefrom(invname, invpost, invgetline, infile));
 }
 
-# if defined( __MSDOS__ ) && defined( TCC )
-
-static char* 
-get_line_in_buffer(char * line, int line_max, char * inbuffer)
+static char *
+invgetline(char *line, int size, void *infile)
 {
-	line[0] = '\0';
-	char * p = inbuffer;
-	while ( 1 ) {
-		if (*p == '\n' || *p == '\0') {
-			strncpy( line, inbuffer, p - inbuffer);
-			return p + 1;
-		}
-		++p;
-	}
-
-	return NULL;
+	return(fgets(line, size, (FILE *) infile));
 }
 
+/* make the inverted index from sorted postings got a line at a time, with
+   the newline, by the nextline function */
+
 long
-invmake_in_mem(char *invname, char *invpost, char *inbuffer)
+invmakefrom(char *invname, char *invpost, INVREADER nextline, void *arg)
 {
-	unsigned char	*s;
-	long	num;
+	char	*s;
 	int	i;
-	long	fileindex = 0;	/* initialze, to avoid warning */
-	unsigned postsize = POSTINC * sizeof(POSTING);
 	unsigned long	*intptr;
 	char	line[TERMMAX];
 	long	tlong;
+	long	nocounts[NPARTS];
 	PARAM	param;
-	POSTING	posting;
+	INVCHUNK *c;
+	long	len, prevline = 0;
 	char 	temp[BLOCKSIZE];
-	char *	buffer;
 #if STATS
 	int	j;
 	unsigned maxtermlen = 0;
@@ -399,12 +195,6 @@ invmake_in_mem(char *invname, char *invpost, char *inbuffer)
 	}
 	postingfile = invpost;
 	nextpost = 0;
-	/* get space for the postings list */
-	if ((POST = malloc(postsize)) == NULL) {
-		invcannotalloc(postsize);
-		return(0);
-	}
-	postptr = POST;
 	/* get space for the superfinger (superindex) */
 	if ((SUPFING = malloc(supersize)) == NULL) {
 		invcannotalloc(supersize);
@@ -439,83 +229,65 @@ invmake_in_mem(char *invname, char *invpost, char *inbuffer)
 	numlogblk = 0;
 	lastinblk = sizeof(t_logicalblk);
 
-	/* now loop as long as more to read (till eof)  */
-	while (get_line_in_buffer(line, TERMMAX, inbuffer) != NULL) {
+	/* the null term */
+	for (i = 0; i < NPARTS; i++)
+		nocounts[i] = 0;
+	if (!invnewterm(NULL, 0, nocounts)) {
+		return(0);
+	}
+	if (!invstart()) {
+		return(0);
+	}
+	/* read the postings into chunks of whole terms, which the worker
+	   pool parses and groups while the next ones are read */
+	c = &chunks[0];
+	while ((*nextline)(line, TERMMAX, arg) != NULL) {
 #if DEBUG || STATS
 		++totpost;
 #endif
-		s = strchr(line, SEP);
-		if (s != NULL) {
-			*s = '\0';
-		}
-		else {
+		if ((s = strchr(line, SEP)) == NULL) {
 			continue;
 		}
 #if STATS
-		if ((i = strlen(line)) > maxtermlen) {
+		if ((i = s - line) > maxtermlen) {
 			maxtermlen = i;
 		}
 #endif
 #if DEBUG
-		printf("%ld: %s ", totpost, line);
+		printf("%ld: %s", totpost, line);
 		fflush(stdout);
 #endif
-		if (strcmp(thisterm, line) == 0) {
-			if (postptr + 10 > POST + postsize / sizeof(POSTING)) {
-				i = postptr - POST;
-				postsize += POSTINC * sizeof(POSTING);
-				if ((POST = realloc(POST, postsize)) == NULL) {
-					invcannotalloc(postsize);
-					return(0);
-				}
-				postptr = i + POST;
-#if DEBUG
-				printf("reallocated post space to %u, totpost=%ld\n",
-				       postsize, totpost);
-#endif
-			}
-			numpost++;
-		} else {
-			/* have a new term */
-			if (!invnewterm()) {
+		/* end the chunk at a new term once it is big enough */
+		if (c->used >= CHUNKSIZE &&
+		    strncmp(c->text + prevline, line, s - line + 1) != 0) {
+			if ((c = invsubmit()) == NULL) {
+				invstop();
 				return(0);
 			}
-			strcpy(thisterm, line);
-			numpost = 1;
-			postptr = POST;
-			fileindex = 0;
 		}
-		/* get the new posting */
-		num = *++s - '!';
-		i = 1;
-		do {
-			num = BASE * num + *++s - '!';
-		} while (++i < PRECISION);
-		posting.lineoffset = num;
-		while (++fileindex < nsrcfiles && num > srcoffset[fileindex]) {
-			;
-		}
-		posting.fileindex = --fileindex;
-		posting.type = *++s;
-		++s;
-		if (*s != '\n') {
-			num = *++s - '!';
-			while (*++s != '\n') {
-				num = BASE * num + *s - '!';
+		len = strlen(line);
+		if (c->used + len + 2 > c->size) {
+			c->size = c->used + len + 2 + CHUNKSIZE;
+			if ((c->text = realloc(c->text, c->size)) == NULL) {
+				invcannotalloc(c->size);
+				invstop();
+				return(0);
 			}
-			posting.fcnoffset = num;
 		}
-		else {
-			posting.fcnoffset = 0;
+		prevline = c->used;
+		memcpy(c->text + c->used, line, len + 1);
+		c->used += len + 1;
+		if (len == 0 || line[len - 1] != '\n') {
+			c->text[c->used - 1] = '\n';
+			c->text[c->used++] = '\0';
 		}
-		*postptr++ = posting;
-#if DEBUG
-		printf("%ld %ld %ld %ld\n", posting.fileindex,
-		       posting.fcnoffset, posting.lineoffset, posting.type);
-		fflush(stdout);
-#endif
+		++c->nlines;
+	}
+	if (c->nlines > 0 && invsubmit() == NULL) {
+		invstop();
+		return(0);
 	}
-	if (!invnewterm()) {
+	if (!invstop()) {
 		return(0);
 	}
 	/* now clean up final block  */
@@ -549,7 +321,9 @@ invmake_in_mem(char *invname, char *invpost, char *inbuffer)
 	necessary for invinsert to correctly create extended blocks 
 	 */
 	i = nextsupfing % sizeof(t_logicalblk);
-	/* write out junk to fill log blk */
+	/* write out zeros to fill log blk, so the index depends only on
+	   the postings */
+	memset(temp, 0, sizeof(t_logicalblk) - i);
 	if (fwrite(temp, sizeof(t_logicalblk) - i, 1, outfile) == 0 ||
 	    fflush(outfile) == EOF) {	/* rewind doesn't check for write failure */
 		goto cannotwrite;
@@ -605,21 +379,21 @@ invmake_in_mem(char *invname, char *invpost, char *inbuffer)
 	}
 #endif
 	/* free all malloc'd memory */
-	free(POST);
 	free(SUPFING);
 	free(SUPINT);
 	return(totterm);
 }
-#endif
 
-/* add a term to the data base */
+/* add the present term to the data base, with its postings grouped by
+   partition and their partition counts */
 
 static int
-invnewterm(void)
+invnewterm(POSTING *grouped, unsigned n, long *termcounts)
 {
     int	backupflag, i, j, holditems, gooditems, howfar;
     unsigned int maxback, len, numwilluse, wdlen;
     char	*tptr, *tptr3;
+    long	*counts;
 
     union {
 	unsigned long	packword[2];
@@ -638,7 +412,7 @@ invnewterm(void)
     len = strlen(thisterm);
     wdlen = (len + (sizeof(long) - 1)) / sizeof(long);
     /* HBB FIXME 20060419: magic number: 3 */
-    numwilluse = (wdlen + 3) * sizeof(long);
+    numwilluse = (wdlen + 3 + NPARTS) * sizeof(long);
     /* new block if at least 1 item in block */
     if (numinvitems && numwilluse + amtused > sizeof(t_logicalblk)) {
 	/* set up new block */
@@ -753,6 +527,7 @@ invnewterm(void)
     /* HBB 20010501: Fixed bug by replacing magic number '8' by
      * what it actually represents. */
     lastinblk -= (numwilluse - 2 * sizeof(long));
+    iteminfo.packword[0] = iteminfo.packword[1] = 0;	/* and any padding */
     iteminfo.e.offset = lastinblk;
     iteminfo.e.size = len;
     iteminfo.e.space = 0;
@@ -760,18 +535,280 @@ invnewterm(void)
     strncpy(logicalblk.chrblk + lastinblk, thisterm, len);
     amtused += numwilluse;
     logicalblk.invblk[(lastinblk/sizeof(long))+wdlen] = nextpost;
-    if ((i = postptr - POST) > 0) {
-	if (fwrite(POST, sizeof(POSTING), i, fpost) == 0) {
+    /* the partition counts follow the postings offset */
+    counts = logicalblk.invblk + (lastinblk/sizeof(long)) + wdlen + 1;
+    for (j = 0; j < NPARTS; j++)
+	counts[j] = termcounts[j];
+    if (n > 0) {
+	if (fwrite(grouped, sizeof(POSTING), n, fpost) == 0) {
 	    invcannotwrite(postingfile);
 	    return(0);
 	}
-	nextpost += i * sizeof(POSTING);
+	nextpost += n * sizeof(POSTING);
     }
     logicalblk.invblk[3+2*numinvitems++] = iteminfo.packword[0];
     logicalblk.invblk[2+2*numinvitems] = iteminfo.packword[1];
     return(1);
 }
 
+/* get the partition of a posting */
+
+static int
+invpart(POSTING *p)
+{
+    switch (p->type) {
+    case DEFINE:
+    case FCNDEF:
+    case CLASSDEF:
+    case ENUMDEF:
+    case MEMBERDEF:
+    case STRUCTDEF:
+    case TYPEDEF:
+    case UNIONDEF:
+    case GLOBALDEF:
+	return(PARTDEF);
+    case FCNCALL:
+	return(PARTCALL);
+    case INCLUDE:
+	return(PARTINCL);
+    }
+    return(p->assign ? PARTASSIGN : PARTOTHER);
+}
+
+/* group the postings of a term by partition and count them.  The sort
+   left them in database offset order, which is kept within each
+   partition. */
+
+static void
+invgroup(POSTING *from, unsigned n, long *counts, POSTING *to)
+{
+    POSTING	*p;
+    long	next[NPARTS];
+    int	i;
+
+    for (i = 0; i < NPARTS; i++)
+	counts[i] = 0;
+    for (p = from; p < from + n; p++)
+	counts[invpart(p)]++;
+    next[0] = 0;
+    for (i = 1; i < NPARTS; i++)
+	next[i] = next[i - 1] + counts[i - 1];
+    for (p = from; p < from + n; p++)
+	to[next[invpart(p)]++] = *p;
+}
+
+/* parse the postings of a chunk and group them by term; this is done by
+   the workers, so it must not touch the index being made */
+
+static void
+invchunk(INVCHUNK *c)
+{
+    unsigned char *s;
+    char	*line, *next, *end;
+    INVTERM	*t = NULL;
+    POSTING	*p;
+    long	num, lo, hi, mid;
+    int	i;
+
+    c->nterms = 0;
+    if (c->nlines > c->mposts) {
+	c->mposts = c->nlines;
+	free(c->posts);
+	free(c->parsed);
+	/* cleared so any padding in the postings written is too */
+	c->posts = calloc(c->mposts, sizeof(POSTING));
+	c->parsed = calloc(c->mposts, sizeof(POSTING));
+	if (c->posts == NULL || c->parsed == NULL) {
+	    invcannotalloc(c->mposts * sizeof(POSTING));
+	    c->mposts = 0;
+	    c->failed = 1;
+	    return;
+	}
+    }
+    p = c->parsed;
+    end = c->text + c->used;
+    for (line = c->text; line < end; line = next) {
+	next = line + strlen(line) + 1;
+	s = (unsigned char *) strchr(line, SEP);
+	*s = '\0';
+	if (t == NULL || strcmp(t->term, line) != 0) {
+	    /* have a new term */
+	    if (c->nterms == c->mterms) {
+		c->mterms += SETINC;
+		if ((c->terms = realloc(c->terms,
+					c->mterms * sizeof(INVTERM))) == NULL) {
+		    invcannotalloc(c->mterms * sizeof(INVTERM));
+		    c->mterms = 0;
+		    c->failed = 1;
+		    return;
+		}
+	    }
+	    t = &c->terms[c->nterms++];
+	    t->term = line;
+	    t->first = p - c->parsed;
+	    t->npost = 0;
+	}
+	/* get the new posting */
+	num = *++s - '!';
+	i = 1;
+	do {
+	    num = BASE * num + *++s - '!';
+	} while (++i < PRECISION);
+	p->lineoffset = num;
+
+	/* the file is the last one starting before the line */
+	lo = 0;
+	hi = nsrcfiles;
+	while (hi - lo > 1) {
+	    mid = (lo + hi) / 2;
+	    if (num > srcoffset[mid]) {
+		lo = mid;
+	    } else {
+		hi = mid;
+	    }
+	}
+	p->fileindex = lo;
+	p->type = *++s & ~ASSIGNFLAG;
+	p->assign = (*s & ASSIGNFLAG) != 0;
+	++s;
+	if (*s != '\n') {
+	    num = *++s - '!';
+	    while (*++s != '\n') {
+		num = BASE * num + *s - '!';
+	    }
+	    p->fcnoffset = num;
+	}
+	else {
+	    p->fcnoffset = 0;
+	}
+	++p;
+	++t->npost;
+    }
+    for (i = 0; i < c->nterms; i++) {
+	t = &c->terms[i];
+	invgroup(c->parsed + t->first, t->npost, t->counts,
+		 c->posts + t->first);
+    }
+}
+
+/* add the terms of a parsed chunk to the index, in order */
+
+static int
+invstitch(INVCHUNK *c)
+{
+    INVTERM	*t;
+    long	i;
+
+    if (c->failed) {
+	return(0);
+    }
+    for (i = 0; i < c->nterms; i++) {
+	t = &c->terms[i];
+	strcpy(thisterm, t->term);
+	numpost = t->npost;
+	if (!invnewterm(c->posts + t->first, t->npost, t->counts)) {
+	    return(0);
+	}
+    }
+    c->used = c->nlines = c->nterms = 0;
+    return(1);
+}
+
+/* set up the chunks, two for each pool worker */
+
+static int
+invstart(void)
+{
+    nchunks = 2 * poolsize();
+    if (nchunks > MAXCHUNKS) {
+	nchunks = MAXCHUNKS;
+    } else if (nchunks < 1) {
+	nchunks = 1;
+    }
+    if ((chunks = calloc(nchunks, sizeof(INVCHUNK))) == NULL) {
+	invcannotalloc(nchunks * sizeof(INVCHUNK));
+	return(0);
+    }
+    submitted = stitched = 0;
+    return(1);
+}
+
+/* give the filled chunk to the pool, add the parsed chunks to the index in
+   order, and return the chunk to fill next, or NULL on an error */
+
+static INVCHUNK *
+invsubmit(void)
+{
+    INVCHUNK	*c = &chunks[submitted % nchunks];
+    int	ok = 1;
+
+    pthread_mutex_lock(&invlock);
+    c->done = 0;
+    ++submitted;
+    pthread_mutex_unlock(&invlock);
+    poolsubmit(&parsing, invtask, c);
+
+    /* stitch the parsed chunks, waiting for the oldest one only if all
+       of them are in use */
+    pthread_mutex_lock(&invlock);
+    while (ok && stitched < submitted) {
+	c = &chunks[stitched % nchunks];
+	if (!c->done) {
+	    if (submitted - stitched < nchunks) {
+		break;
+	    }
+	    pthread_cond_wait(&invcond, &invlock);
+	    continue;
+	}
+	pthread_mutex_unlock(&invlock);
+	ok = invstitch(c);
+	pthread_mutex_lock(&invlock);
+	++stitched;
+    }
+    pthread_mutex_unlock(&invlock);
+    return(ok ? &chunks[submitted % nchunks] : NULL);
+}
+
+/* add the rest of the parsed chunks to the index, and free the chunks */
+
+static int
+invstop(void)
+{
+    INVCHUNK	*c;
+    int	ok = 1, i;
+
+    poolwait(&parsing);
+    for (; stitched < submitted; ++stitched) {
+	if (ok) {
+	    ok = invstitch(&chunks[stitched % nchunks]);
+	}
+    }
+    for (i = 0; i < nchunks; ++i) {
+	c = &chunks[i];
+	free(c->text);
+	free(c->terms);
+	free(c->posts);
+	free(c->parsed);
+    }
+    free(chunks);
+    chunks = NULL;
+    return(ok);
+}
+
+/* pool task parsing a chunk */
+
+static void
+invtask(void *arg)
+{
+    INVCHUNK	*c = arg;
+
+    invchunk(c);
+    pthread_mutex_lock(&invlock);
+    c->done = 1;
+    pthread_cond_broadcast(&invcond);
+    pthread_mutex_unlock(&invlock);
+}
+
 /* 
  * If 'invname' ends with the 'from' substring, it is replaced inline with the
  * 'to' substring (which must be of the exact same length), and the function
@@ -1152,6 +1189,11 @@ boolready(void)
 		invcannotalloc(SETINC);
 		return(-1);
 	}
+	if (runbuf != NULL) {
+		free(runbuf);
+		runbuf = NULL;
+	}
+	runsize = 0;
 	item = item1;
 	enditem = item;
 	return(0);
@@ -1165,24 +1207,35 @@ boolclear(void)
 	enditem = item;
 }
 
+/* add the postings of the present term in the partitions selected by the
+   'parts' mask to the posting set */
+
 POSTING *
-boolfile(INVCONTROL *invcntl, long *num, int boolarg)
+boolfile(INVCONTROL *invcntl, long *num, int boolarg, int parts)
 {
 	ENTRY	*entryptr;
 	FILE	*file;
 	void	*ptr;
 	unsigned long	*ptr2;
+	unsigned long	offset;
 	POSTING	*newitem = NULL; /* initialize, to avoid warning */
-	POSTING	posting;
+	POSTING	*run[NPARTS + 1], *runend[NPARTS + 1], *runp;
 	unsigned u;
-	POSTING *newsetp = NULL, *set1p;
-	long	newsetc, set1c, set2c;
+	POSTING *newsetp = NULL;
+	long	newsetc;
+	int	i, j, nruns;
 
 	/* FIXME HBB: magic number alert! (3) */
 	entryptr = (ENTRY *) (invcntl->logblk->invblk + 3) + invcntl->keypnt;
 	ptr = invcntl->logblk->chrblk + entryptr->offset;
 	ptr2 = ((unsigned long *) ptr) + (entryptr->size + (sizeof(long) - 1)) / sizeof(long);
-	*num = entryptr->post;
+	/* the postings offset is followed by the partition counts */
+	*num = 0;
+	for (i = 0; i < NPARTS; i++) {
+		if (parts & PARTMASK(i)) {
+			*num += ptr2[i + 1];
+		}
+	}
 	switch (boolarg) {
 	case BOOL_OR:
 	case NOT:
@@ -1230,59 +1283,58 @@ boolfile(INVCONTROL *invcntl, long *num, int boolarg)
 			}
 			newitem = item2;
 		}
-#if 0 /* this write is only need by commented-out code later */
-		set1p = item;
-#endif
 		newsetp = newitem;
 	}
+	/* read in the selected partitions, skipping over the others */
+	if (*num > runsize) {
+		u = *num + SETINC;
+		if ((runp = realloc(runbuf, u * sizeof(POSTING))) == NULL) {
+			goto cannotalloc;
+		}
+		runbuf = runp;
+		runsize = u;
+	}
 	file = invcntl->postfile;
-	fseek(file, *ptr2, SEEK_SET);
-	fread(&posting, sizeof(posting), 1, file);
+	offset = *ptr2;
+	runp = runbuf;
+	nruns = 0;
+	for (i = 0; i < NPARTS; i++) {
+		if ((parts & PARTMASK(i)) && ptr2[i + 1] > 0) {
+			fseek(file, offset, SEEK_SET);
+			fread(runp, sizeof(POSTING), ptr2[i + 1], file);
+			run[nruns] = runp;
+			runp += ptr2[i + 1];
+			runend[nruns++] = runp;
+		}
+		offset += ptr2[i + 1] * sizeof(POSTING);
+	}
 	newsetc = 0;
 	switch (boolarg) {
 	case BOOL_OR:
-		/* while something in both sets */
-		set1p = item;
+		/* merge the set and the partitions, each in database offset
+		   order, dropping postings already in the set */
+		run[nruns] = item;
+		runend[nruns] = item + numitems;
 		newsetp = newitem;
-		for (set1c = 0, set2c = 0;
-		    set1c < numitems && set2c < *num; newsetc++) {
-			if (set1p->lineoffset < posting.lineoffset) {
-				*newsetp++ = *set1p++;
-				set1c++;
-			}
-			else if (set1p->lineoffset > posting.lineoffset) {
-				*newsetp++ = posting;
-				fread(&posting, (int) sizeof(posting), 1, file);
-				set2c++;
-			}
-			else if (set1p->type < posting.type) {
-				*newsetp++ = *set1p++;
-				set1c++;
-			}
-			else if (set1p->type > posting.type) {
-				*newsetp++ = posting;
-				fread(&posting, (int) sizeof(posting), 1, file);
-				set2c++;
-			}
-			else {	/* identical postings */
-				*newsetp++ = *set1p++;
-				set1c++;
-				fread(&posting, (int) sizeof(posting), 1, file);
-				set2c++;
+		for (;;) {
+			for (j = -1, i = 0; i <= nruns; i++) {
+				if (run[i] < runend[i] &&
+				    (j < 0 || postcmp(run[i], run[j]) < 0)) {
+					j = i;
+				}
 			}
-		}
-		/* find out what ran out and move the rest in */
-		if (set1c < numitems) {
-			newsetc += numitems - set1c;
-			while (set1c++ < numitems) {
-				*newsetp++ = *set1p++;
+			if (j < 0) {
+				break;
 			}
-		} else {
-			while (set2c++ < *num) {
-				*newsetp++ = posting;
-				newsetc++;
-				fread(&posting, (int) sizeof(posting), 1, file);
+			*newsetp = *run[j]++;
+			for (i = 0; i <= nruns; i++) {
+				if (run[i] < runend[i] &&
+				    postcmp(run[i], newsetp) == 0) {
+					run[i]++;
+				}
 			}
+			newsetp++;
+			newsetc++;
 		}
 		item = newitem;
 		break; /* end of BOOL_OR */
@@ -1390,6 +1442,21 @@ boolfile(INVCONTROL *invcntl, long *num, int boolarg)
 	return((POSTING *) item);
 }
 
+/* compare postings by database offset, reference type and then the
+   assignment flag */
+
+static int
+postcmp(POSTING *p1, POSTING *p2)
+{
+	if (p1->lineoffset != p2->lineoffset) {
+		return(p1->lineoffset < p2->lineoffset ? -1 : 1);
+	}
+	if (p1->type != p2->type) {
+		return(p1->type - p2->type);
+	}
+	return(p1->assign - p2->assign);
+}
+
 #if 0
 POSTING *
 boolsave(int clear)		/* flag about whether to clear core  */
@@ -55,11 +55,27 @@
 # endif
 #endif
 
+/* postings temporary file reference type flag for an assignment */
+#define	ASSIGNFLAG	0200
+
 /* inverted index access parameters */
 #define INVAVAIL	0
 #define INVBUSY		1
 #define INVALONE	2
 
+/* posting partitions; a term's postings are stored grouped by these,
+   in this order, so a query can read only the references it needs */
+#define	PARTDEF		0	/* definitions */
+#define	PARTCALL	1	/* function calls */
+#define	PARTINCL	2	/* #includes */
+#define	PARTASSIGN	3	/* assignments to other references */
+#define	PARTOTHER	4	/* all other references */
+#define	NPARTS		5
+
+/* partition masks for boolfile() */
+#define	PARTMASK(part)	(1 << (part))
+#define	PARTALL		(PARTMASK(NPARTS) - 1)
+
 /* boolean set operations */
 #define	BOOL_OR		3
 #define	AND		4
@@ -98,24 +114,27 @@ typedef	struct {
 	long	lineoffset;	/* source line database offset */
 	long	fcnoffset;	/* function name database offset */
 	long	fileindex : 24;	/* source file name index */
-	long	type : 8;	/* reference type (mark character) */
+	unsigned long type : 7;	/* reference type (mark character) */
+	unsigned long assign : 1; /* reference is assigned to */
 } POSTING;
 
+/* sorted postings line reader for invmakefrom() */
+typedef	char	*(*INVREADER)(char *line, int size, void *arg);
+
 extern	long	*srcoffset;	/* source file name database offsets */
 extern	int	nsrcoffset;	/* number of file name database offsets */
 
 
 void	boolclear(void);
-POSTING	*boolfile(INVCONTROL *invcntl, long *num, int boolarg);
+POSTING	*boolfile(INVCONTROL *invcntl, long *num, int boolarg, int parts);
 void	invclose(INVCONTROL *invcntl);
 void	invdump(INVCONTROL *invcntl, char *term);
 long	invfind(INVCONTROL *invcntl, char *searchterm);
 int	invforward(INVCONTROL *invcntl);
 int	invopen(INVCONTROL *invcntl, char *invname, char *invpost, int status);
 long	invmake(char *invname, char *invpost, FILE *infile);
+long	invmakefrom(char *invname, char *invpost, INVREADER nextline,
+		    void *arg);
 long	invterm(INVCONTROL *invcntl, char *term);
-#if defined(__MSDOS__) && defined(TCC)
-long	invmake_in_mem(char *invname, char *invpost, char *inbuffer);
-#endif
 
 #endif /* CSCOPE_INVLIB_H */
@@ -49,5 +49,6 @@ FILE	*mypopen(char *cmd, char *mode);
 int	mypclose(FILE *ptr);
 FILE	*vpfopen(char *filename, char *type);
 void	egrepcaseless(int i);
+char	*egrepskips(long *files, long *fileskips, long *bytes, long *byteskips);
 
 #endif /* CSCOPE_LIBRARY_H */
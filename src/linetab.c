@@ -0,0 +1,473 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	source line table
+ *
+ *	The table is made with the database and holds, for every source
+ *	file, the offsets of the starts of its lines, so a text search can
+ *	number the line of a match, and find the text of a numbered line,
+ *	without reading the file up to it.  The offsets are kept as the
+ *	lengths of the lines, 7 bits to a byte, with the offset of every
+ *	LTSTEP'th line in a checkpoint, so a line is found with a binary
+ *	search of the file's checkpoints and at most LTSTEP lengths.  A
+ *	file's lines are only used while its size and modification time
+ *	are those it had when they were counted.  The lines of a file the
+ *	build cross-references are counted as the scanner reads it, and
+ *	those of the others copied from the old table.  The file is mapped
+ *	read-only when the database is opened.
+ */
+
+#include "global.h"
+
+#include "alloc.h"
+#include "linetab.h"
+
+#include <sys/stat.h>
+
+#define	CHECKINC	10000	/* checkpoint list size increment */
+#define	DATAINC		65536	/* line length space size increment */
+#define	FILEINC		1000	/* file list size increment */
+#define	POOLINC		65536	/* name string space size increment */
+#define	READSIZE	65536	/* source file read size */
+
+typedef	struct {		/* a table being made */
+	char	*pool;		/* name string space */
+	long	npool, mpool;
+	LTFILE	*files;		/* files */
+	long	nfiles, mfiles;
+	LTCHECK	*checks;	/* checkpoints in file order */
+	long	nchecks, mchecks;
+	unsigned char *data;	/* line lengths */
+	long	ndata, mdata;
+	long	laststart;	/* start of the last line added */
+} LTMAKE;
+
+static	LTMAKE	table;		/* the table file's, in name order */
+static	LTMAKE	scan;		/* the lines counted while cross-referencing */
+static	long	scanfile = -1;	/* file being counted */
+static	long	scanoffset;	/* and its offset */
+
+static	void	addline(LTMAKE *t, LTFILE *f, long start);
+static	LTFILE	*addfile(LTMAKE *t, char *file, struct stat *st);
+static	void	copylines(LINECONTROL *old, LTFILE *of, LTFILE *f);
+static	BOOL	countlines(char *file, LTFILE *f);
+static	int	filecompare(const void *f1, const void *f2);
+static	long	getlength(unsigned char **p);
+static	void	linefree(LTMAKE *t);
+static	LTFILE	*linelookup(LINECONTROL *lc, char *file);
+static	int	namecompare(const void *s1, const void *s2);
+static	BOOL	linewrite(char *linefile);
+
+/* make the line table of the named source files, taking the lines of the
+   files counted while they were cross-referenced, or copying those of the
+   files unchanged since the old table; returns the number of files, or -1
+   if the table could not be written */
+
+long
+linemake(char *linefile, LINECONTROL *old, char **names, long count)
+{
+	struct	stat	statstruct;
+	LINECONTROL counted;
+	LTHEADER header;
+	char	**sorted;
+	LTFILE	*f, *of;
+	long	i;
+
+	/* the files in name order, so they can be found with a binary
+	   search */
+	sorted = mymalloc((count + 1) * sizeof(char *));
+	memcpy(sorted, names, count * sizeof(char *));
+	qsort(sorted, count, sizeof(char *), namecompare);
+
+	/* and so can those counted */
+	qsort(scan.files, scan.nfiles, sizeof(LTFILE), filecompare);
+	header.nfiles = scan.nfiles;
+	counted.header = &header;
+	counted.files = scan.files;
+	counted.checks = scan.checks;
+	counted.data = scan.data;
+	counted.strings = scan.pool;
+
+	for (i = 0; i < count; ++i) {
+		if (stat(sorted[i], &statstruct) != 0 ||
+		    (i > 0 && strcmp(sorted[i], sorted[i - 1]) == 0)) {
+			continue;
+		}
+		f = addfile(&table, sorted[i], &statstruct);
+
+		/* take the lines of a file counted or unchanged, or count
+		   them */
+		if ((of = linelookup(&counted, sorted[i])) != NULL &&
+		    of->size == f->size && of->mtime == f->mtime) {
+			copylines(&counted, of, f);
+		} else if (old != NULL &&
+		    (of = linelookup(old, sorted[i])) != NULL &&
+		    of->size == f->size && of->mtime == f->mtime) {
+			copylines(old, of, f);
+		} else if (countlines(sorted[i], f) == NO) {
+			table.npool = f->name;	/* drop it */
+			--table.nfiles;
+		}
+	}
+	free(sorted);
+	i = linewrite(linefile) == YES ? table.nfiles : -1;
+	linefree(&table);
+	linefree(&scan);
+	return(i);
+}
+
+/* add a file to a table */
+
+static LTFILE *
+addfile(LTMAKE *t, char *file, struct stat *st)
+{
+	LTFILE	*f;
+	long	len;
+
+	if (t->nfiles == t->mfiles) {
+		t->mfiles += FILEINC;
+		t->files = myrealloc(t->files, t->mfiles * sizeof(LTFILE));
+	}
+	len = strlen(file) + 1;
+	if (t->npool + len > t->mpool) {
+		t->mpool += (len > POOLINC) ? len : POOLINC;
+		t->pool = myrealloc(t->pool, t->mpool);
+	}
+	f = &t->files[t->nfiles++];
+	f->name = t->npool;
+	memcpy(t->pool + t->npool, file, len);
+	t->npool += len;
+	f->size = st->st_size;
+	f->mtime = st->st_mtime;
+	f->nlines = 0;
+	f->checks = t->nchecks;
+	return(f);
+}
+
+/* count the lines of a source file; returns NO if it cannot be read */
+
+static BOOL
+countlines(char *file, LTFILE *f)
+{
+	FILE	*fptr;
+	char	*buf, *p, *end;
+	long	offset = 0;
+	long	n;
+
+	if ((fptr = myfopen(file, "rb")) == NULL) {
+		return(NO);
+	}
+	buf = mymalloc(READSIZE);
+	addline(&table, f, 0);
+	while ((n = fread(buf, 1, READSIZE, fptr)) > 0) {
+		end = buf + n;
+		for (p = buf; (p = memchr(p, '\n', end - p)) != NULL; ) {
+			++p;
+			addline(&table, f, offset + (p - buf));
+		}
+		offset += n;
+	}
+	free(buf);
+	fclose(fptr);
+	return(YES);
+}
+
+/* start counting the lines of a source file as it is cross-referenced */
+
+void
+linebegin(char *file, struct stat *st)
+{
+	scanfile = scan.nfiles;
+	scanoffset = 0;
+	addline(&scan, addfile(&scan, file, st), 0);
+}
+
+/* count the lines in the next block of the file read */
+
+void
+linescan(char *buf, long n)
+{
+	LTFILE	*f;
+	char	*p, *end;
+
+	if (scanfile < 0) {
+		return;
+	}
+	f = &scan.files[scanfile];
+	end = buf + n;
+	for (p = buf; (p = memchr(p, '\n', end - p)) != NULL; ) {
+		++p;
+		addline(&scan, f, scanoffset + (p - buf));
+	}
+	scanoffset += n;
+}
+
+/* finish counting the lines of a file, dropping them if it was not all
+   read */
+
+void
+lineend(BOOL complete)
+{
+	LTFILE	*f;
+
+	if (scanfile < 0) {
+		return;
+	}
+	f = &scan.files[scanfile];
+	if (complete == NO || scanoffset != f->size) {
+		scan.npool = f->name;
+		scan.nchecks = f->checks;
+		scan.ndata = scan.checks[f->checks].data;
+		--scan.nfiles;
+	}
+	scanfile = -1;
+}
+
+/* copy the lines of a file from another table */
+
+static void
+copylines(LINECONTROL *old, LTFILE *of, LTFILE *f)
+{
+	unsigned char *p = NULL;
+	long	offset = 0;
+	long	i;
+
+	for (i = 0; i < of->nlines; ++i) {
+		if (i % LTSTEP == 0) {
+			offset = old->checks[of->checks + i / LTSTEP].offset;
+			p = old->data + old->checks[of->checks + i / LTSTEP].data;
+		} else {
+			offset += getlength(&p);
+		}
+		addline(&table, f, offset);
+	}
+}
+
+/* add the start of the next line of a file */
+
+static void
+addline(LTMAKE *t, LTFILE *f, long start)
+{
+	unsigned long len;
+
+	if (f->nlines % LTSTEP == 0) {
+		if (t->nchecks == t->mchecks) {
+			t->mchecks += CHECKINC;
+			t->checks = myrealloc(t->checks,
+					      t->mchecks * sizeof(LTCHECK));
+		}
+		t->checks[t->nchecks].offset = start;
+		t->checks[t->nchecks].data = t->ndata;
+		++t->nchecks;
+	} else {
+		if (t->ndata + 10 > t->mdata) {
+			t->mdata += DATAINC;
+			t->data = myrealloc(t->data, t->mdata);
+		}
+		for (len = start - t->laststart; len >= 0x80; len >>= 7) {
+			t->data[t->ndata++] = (len & 0x7f) | 0x80;
+		}
+		t->data[t->ndata++] = len;
+	}
+	t->laststart = start;
+	++f->nlines;
+}
+
+/* get a line length, and move past it */
+
+static long
+getlength(unsigned char **p)
+{
+	unsigned long len = 0;
+	int	shift = 0;
+
+	while (**p & 0x80) {
+		len |= (unsigned long) (*(*p)++ & 0x7f) << shift;
+		shift += 7;
+	}
+	len |= (unsigned long) *(*p)++ << shift;
+	return(len);
+}
+
+/* write the table file */
+
+static BOOL
+linewrite(char *linefile)
+{
+	FILE	*out;
+	LTHEADER header;
+	BOOL	ok;
+
+	if ((out = myfopen(linefile, "wb")) == NULL) {
+		posterr("cscope: cannot create file %s", linefile);
+		return(NO);
+	}
+	header.version = LTVERSION;
+	header.nfiles = table.nfiles;
+	header.nchecks = table.nchecks;
+	header.datasize = table.ndata;
+	header.strsize = table.npool;
+	fwrite(&header, sizeof(header), 1, out);
+	fwrite(table.files, sizeof(LTFILE), table.nfiles, out);
+	fwrite(table.checks, sizeof(LTCHECK), table.nchecks, out);
+	fwrite(table.data, 1, table.ndata, out);
+	fwrite(table.pool, 1, table.npool, out);
+	ok = (ferror(out) == 0);
+	if (fclose(out) == EOF || ok == NO) {
+		posterr("cscope: cannot write file %s", linefile);
+		unlink(linefile);
+		return(NO);
+	}
+	return(YES);
+}
+
+/* free the storage of a table being made */
+
+static void
+linefree(LTMAKE *t)
+{
+	free(t->pool);
+	free(t->files);
+	free(t->checks);
+	free(t->data);
+	memset(t, 0, sizeof(LTMAKE));
+}
+
+/* compare the names of two counted files for qsort */
+
+static int
+filecompare(const void *f1, const void *f2)
+{
+	return(strcmp(scan.pool + ((LTFILE *) f1)->name,
+		      scan.pool + ((LTFILE *) f2)->name));
+}
+
+/* compare two file names for qsort */
+
+static int
+namecompare(const void *s1, const void *s2)
+{
+	return(strcmp(*(char **) s1, *(char **) s2));
+}
+
+/* map the line table */
+
+int
+lineopen(LINECONTROL *lc, char *linefile)
+{
+	LTHEADER *h;
+	long	size;
+
+	lc->header = NULL;
+	if (os_mmap(linefile, &lc->map) != 0) {
+		return(-1);
+	}
+	h = (LTHEADER *) lc->map.buffer;
+	if (lc->map.size < (int) sizeof(LTHEADER) ||
+	    h->version != LTVERSION) {
+		os_munmap(&lc->map);
+		return(-1);
+	}
+	size = sizeof(LTHEADER) + h->nfiles * sizeof(LTFILE) +
+		h->nchecks * sizeof(LTCHECK) + h->datasize + h->strsize;
+	if (size != lc->map.size) {
+		posterr("cscope: incorrect line table file format: %s",
+			linefile);
+		os_munmap(&lc->map);
+		return(-1);
+	}
+	lc->header = h;
+	lc->files = (LTFILE *) (h + 1);
+	lc->checks = (LTCHECK *) (lc->files + h->nfiles);
+	lc->data = (unsigned char *) (lc->checks + h->nchecks);
+	lc->strings = (char *) (lc->data + h->datasize);
+	return(0);
+}
+
+void
+lineclose(LINECONTROL *lc)
+{
+	if (lc->header != NULL) {
+		os_munmap(&lc->map);
+		lc->header = NULL;
+	}
+}
+
+/* find the lines of a source file, or return NULL if it is not in the
+   table or has changed since its lines were counted */
+
+LTFILE *
+linefind(LINECONTROL *lc, char *file)
+{
+	struct	stat	statstruct;
+	LTFILE	*f;
+
+	if ((f = linelookup(lc, file)) == NULL ||
+	    stat(file, &statstruct) != 0 ||
+	    f->size != (long) statstruct.st_size ||
+	    f->mtime != (long) statstruct.st_mtime) {
+		return(NULL);
+	}
+	return(f);
+}
+
+static LTFILE *
+linelookup(LINECONTROL *lc, char *file)
+{
+	long	low = 0, high, mid;
+	int	c;
+
+	if (lc->header == NULL) {
+		return(NULL);
+	}
+	high = lc->header->nfiles - 1;
+	while (low <= high) {
+		mid = (low + high) / 2;
+		if ((c = strcmp(file, lc->strings + lc->files[mid].name)) == 0) {
+			return(&lc->files[mid]);
+		}
+		if (c < 0) {
+			high = mid - 1;
+		} else {
+			low = mid + 1;
+		}
+	}
+	return(NULL);
+}
+
+/* return the number of the line with the file offset */
+
+long
+lineof(LINECONTROL *lc, LTFILE *f, long offset)
+{
+	LTCHECK	*c = &lc->checks[f->checks];
+	unsigned char *p;
+	long	low = 0, high, mid;
+	long	line, end, start, len;
+
+	/* the last checkpoint at or before the offset */
+	high = (f->nlines - 1) / LTSTEP;
+	while (low < high) {
+		mid = (low + high + 1) / 2;
+		if (c[mid].offset <= offset) {
+			low = mid;
+		} else {
+			high = mid - 1;
+		}
+	}
+	line = low * LTSTEP;
+	end = line + LTSTEP;
+	if (end > f->nlines) {
+		end = f->nlines;
+	}
+	start = c[low].offset;
+	p = lc->data + c[low].data;
+	while (line + 1 < end) {
+		len = getlength(&p);
+		if (start + len > offset) {
+			break;
+		}
+		start += len;
+		++line;
+	}
+	return(line + 1);
+}
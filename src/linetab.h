@@ -0,0 +1,56 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	source line table definitions
+ */
+
+#ifndef CSCOPE_LINETAB_H
+#define CSCOPE_LINETAB_H
+
+#include "global.h"
+#include "os_wrapper.h"
+
+#include <sys/stat.h>
+
+#define	LTVERSION	1	/* line table format version */
+#define	LTSTEP		64	/* lines between table checkpoints */
+
+typedef	struct {
+	long	version;	/* line table format version */
+	long	nfiles;		/* number of source files */
+	long	nchecks;	/* number of checkpoints */
+	long	datasize;	/* size of the line length space */
+	long	strsize;	/* size of the string space */
+} LTHEADER;
+
+typedef	struct {
+	long	name;		/* file name offset in the string space */
+	long	size;		/* file size when the table was made */
+	long	mtime;		/* and its modification time */
+	long	nlines;		/* number of line starts */
+	long	checks;		/* first of its checkpoints */
+} LTFILE;
+
+typedef	struct {
+	long	offset;		/* file offset of every LTSTEP'th line */
+	long	data;		/* the lengths of the lines from it */
+} LTCHECK;
+
+typedef	struct {
+	mmap_info_t map;	/* mapped table file */
+	LTHEADER *header;	/* table parameters */
+	LTFILE	*files;		/* source files sorted by name */
+	LTCHECK	*checks;	/* checkpoints in file order */
+	unsigned char *data;	/* line lengths, 7 bits to a byte */
+	char	*strings;	/* string space */
+} LINECONTROL;
+
+void	linebegin(char *file, struct stat *st);
+void	lineclose(LINECONTROL *lc);
+void	lineend(BOOL complete);
+LTFILE	*linefind(LINECONTROL *lc, char *file);
+long	linemake(char *linefile, LINECONTROL *old, char **names, long count);
+long	lineof(LINECONTROL *lc, LTFILE *f, long offset);
+int	lineopen(LINECONTROL *lc, char *linefile);
+void	linescan(char *buf, long n);
+
+#endif /* CSCOPE_LINETAB_H */
@@ -44,6 +44,7 @@
 #include "scanner.h" 
 #include "alloc.h"
 #include "os_wrapper.h"
+#include "postsort.h"
 
 #include <stdlib.h>	/* atoi */
 #if defined(USE_NCURSES) && !defined(RENAMED_NCURSES)
@@ -84,6 +85,7 @@ BOOL	lineflagafterfile;
 char	*argv0;			/* command name */
 BOOL	compress = YES;		/* compress the characters in the crossref */
 BOOL	dbtruncated;		/* database symbols are truncated to 8 chars */
+BOOL	partialdb;		/* database has only some of the files */
 int	dispcomponents = 1;	/* file path components to display */
 #if CCS
 BOOL	displayversion;		/* display the C Compilation System version */
@@ -113,6 +115,7 @@ char	tempstring[TEMPSTRING_LEN + 1]; /* use this as a buffer, instead of 'yytext
 				 * which had better be left alone */
 char	*tmpdir;		/* temporary directory */
 int		thread_worker_count = 8; /* Give the thread count */
+int	calldepth = 1;		/* levels of callers/callees to find */
 char    *code_types[MAX_CODE_TYPE];
 int     code_type_count = 0;
 
@@ -160,7 +163,7 @@ char ** parse_options(int *argc, char **argv)
 	
 
 	while ((opt = getopt_long(argcc, argv,
-	       "hVbcCdDeF:f:t:I:i:kLl0:1:2:3:4:5:6:7:8:9:P:p:qRs:TUuv",
+	       "hVbB:cCdDeF:f:G:t:I:i:j:kLl0:1:2:3:4:5:6:7:8:9:P:p:qRs:TUuv",
 	       lopts, &longind)) != -1) {
 		switch(opt) {
 
@@ -180,6 +183,15 @@ char ** parse_options(int *argc, char **argv)
 		case '9':
 			/* The input fields numbers for line mode operation */
 			field = opt - '0';
+
+			/* -10 is the field after 9; a C symbol for -1 cannot
+			   start with a digit */
+			if (field == 1 && *optarg == '0') {
+				field = MULTISTRING;
+				if (*++optarg == '\0' && optind < argcc) {
+					optarg = argv[optind++];
+				}
+			}
 			if (strlen(optarg) > PATHLEN) {
 				    postfatal("\
 					cscope: pattern too long, cannot be > \
@@ -191,6 +203,9 @@ char ** parse_options(int *argc, char **argv)
 			buildonly = YES;
 			linemode  = YES;
 			break;
+		case 'B':	/* build progressively, these files first */
+			buildprefix = optarg;
+			break;
 		case 'c':	/* ASCII characters only in crossref */
 			compress = NO;
 			break;
@@ -258,11 +273,25 @@ char ** parse_options(int *argc, char **argv)
 			invname = my_strdup(path);
 			strcpy(s, ".po");
 			invpost = my_strdup(path);
+			strcpy(s, ".cg");
+			cgname = my_strdup(path);
+			strcpy(s, ".ln");
+			linename = my_strdup(path);
 			break;
 
 		case 'F':	/* symbol reference lines file */
 			reflines = optarg;
 			break;
+		case 'G':	/* levels of callers/callees to find */
+			if (*optarg < '0' || *optarg > '9') {
+				fprintf(stderr, "\
+%s: -G option: missing or invalid numeric value\n", 
+					argv0);
+				usage();
+				myexit(1);
+			}
+			calldepth = atoi(optarg);
+			break;
 		case 't':
 			if ( code_type_count < MAX_CODE_TYPE ) {
 				code_types[code_type_count] = optarg;
@@ -278,6 +307,11 @@ char ** parse_options(int *argc, char **argv)
 		case 'I':	/* #include file directory */
 			includedir(optarg);
 			break;
+		case 'j':	/* worker threads to use */
+			if ((thread_worker_count = atoi(optarg)) < 1) {
+				thread_worker_count = 1;
+			}
+			break;
 		case 'p':	/* file path components to display */
 			dispcomponents = atoi(optarg);
 			break;
@@ -350,7 +384,10 @@ main(int argc, char **argv)
 	    /* look for an input field number */
 	    if (isdigit((unsigned char) *s)) {
 		field = *s - '0';
-		if (field > 8) {
+		if (field == 1 && s[1] == '0') {
+		    field = MULTISTRING;
+		    ++s;
+		} else if (field > 8) {
 		    field = 8;
 		}
 		if (*++s == '\0' && --argc > 0) {
@@ -420,10 +457,13 @@ cscope: pattern too long, cannot be > %d characters\n", PATLEN);
 		recurse_dir = YES;
 		break;
 	    case 't':	/* extra code types */
+	    case 'B':	/* build progressively, these files first */
 	    case 'f':	/* alternate cross-reference file */
 	    case 'F':	/* symbol reference lines file */
+	    case 'G':	/* levels of callers/callees to find */
 	    case 'i':	/* file containing file names */
 	    case 'I':	/* #include file directory */
+	    case 'j':	/* worker threads to use */
 	    case 'p':	/* file path components to display */
 	    case 'P':	/* prepend path to file names */
 	    case 's':	/* additional source file directory */
@@ -438,6 +478,9 @@ cscope: pattern too long, cannot be > %d characters\n", PATLEN);
 		    goto usage;
 		}
 		switch (c) {
+		case 'B':	/* build progressively, these files first */
+		    buildprefix = s;
+		    break;
 		case 'f':	/* alternate cross-reference file */
 		    reffile = s;
 		    if (strlen(reffile) > sizeof(path) - 3) {
@@ -458,16 +501,38 @@ cscope: reffile too long, cannot be > %d characters\n", sizeof(path) - 3);
 		    invname = my_strdup(path);
 		    strcpy(s, ".po");
 		    invpost = my_strdup(path);
+		    strcpy(s, ".cg");
+		    cgname = my_strdup(path);
+		    strcpy(s, ".ln");
+		    linename = my_strdup(path);
 		    break;
 		case 'F':	/* symbol reference lines file */
 		    reflines = s;
 		    break;
+		case 'G':	/* levels of callers/callees to find */
+		    if (*s < '0' || *s > '9' ) {
+			fprintf(stderr, "\
+%s: -G option: missing or invalid numeric value\n", 
+				argv0);
+			goto usage;
+		    }
+		    calldepth = atoi(s);
+		    break;
 		case 'i':	/* file containing file names */
 		    namefile = s;
 		    break;
 		case 'I':	/* #include file directory */
 		    includedir(s);
 		    break;
+		case 'j':	/* worker threads to use */
+		    if (*s < '1' || *s > '9' ) {
+			fprintf(stderr, "\
+%s: -j option: missing or invalid numeric value\n", 
+				argv0);
+			goto usage;
+		    }
+		    thread_worker_count = atoi(s);
+		    break;
 		case 'p':	/* file path components to display */
 		    if (*s < '0' || *s > '9' ) {
 			fprintf(stderr, "\
@@ -601,6 +666,10 @@ cscope: Could not create private temp dir %s\n",
 	    invname = my_strdup(path);
 	    snprintf(path, sizeof(path), "%s/%s", home, invpost);
 	    invpost = my_strdup(path);
+	    snprintf(path, sizeof(path), "%s/%s", home, cgname);
+	    cgname = my_strdup(path);
+	    snprintf(path, sizeof(path), "%s/%s", home, linename);
+	    linename = my_strdup(path);
 	}
     }
 
@@ -670,6 +739,9 @@ cscope: Could not create private temp dir %s\n",
 		    dbtruncated = YES;
 		    trun_syms = YES;
 		    break;
+		case 'P':	/* only some of the files */
+		    partialdb = YES;
+		    break;
 		}
 	    }
 	    initcompress();
@@ -788,7 +860,11 @@ cscope: cannot read source file name from file %s\n",
 	initcompress();
 	if (linemode == NO || verbosemode == YES)    /* display if verbose as well */
 	    postmsg("Building cross-reference...");    		    
-	build();
+	if (buildprefix != NULL) {
+	    progressbuild();
+	} else {
+	    build();
+	}
 	if (linemode == NO )
 	    clearmsg();	/* clear any build progress message */
 	if (buildonly == YES) {
@@ -800,6 +876,10 @@ cscope: cannot read source file name from file %s\n",
     /* if using the line oriented user interface so cscope can be a 
        subprocess to emacs or samuel */
     if (linemode == YES) {
+	if (partialdb == YES) {
+	    fprintf(stderr, "\
+cscope: the database is still being built, results may be incomplete\n");
+	}
 	if (*Pattern != '\0') {		/* do any optional search */
 	    if (search() == YES) {
 		/* print the total number of lines in
@@ -843,7 +923,12 @@ cscope: cannot read source file name from file %s\n",
 	    case '8':
 	    case '9':	/* samuel only */
 		field = *buf - '0';
-		strcpy(Pattern, buf + 1);
+		s = buf + 1;
+		if (field == 1 && *s == '0') {
+		    field = MULTISTRING;
+		    ++s;
+		}
+		strcpy(Pattern, s);
 		search();
 		printf("cscope: %d lines\n", totallines);
 		while ((c = getc(refsfound)) != EOF) {
@@ -1042,7 +1127,7 @@ static void
 usage(void)
 {
 	fprintf(stderr, "Usage: cscope [-bcCdehklLqRTuUvV] [-f file] [-F file] [-i file] [-I dir] [-s dir]\n");
-	fprintf(stderr, "              [-p number] [-P path] [-[0-8] pattern] [source files]\n");
+	fprintf(stderr, "              [-p number] [-P path] [-G depth] [-B path] [-j number] [-num pattern] [source files]\n");
 }
 
 
@@ -1054,6 +1139,8 @@ longusage(void)
 	fprintf(stderr, "\
 \n\
 -b            Build the cross-reference only.\n\
+-B path       Build progressively, path and recently changed files first,\n\
+              publishing partial cross-references on the way.\n\
 -C            Ignore letter case when searching.\n\
 -c            Use only ASCII characters in the cross-ref file (don't compress).\n\
 -d            Do not update the cross-reference.\n\
@@ -1062,9 +1149,13 @@ longusage(void)
 -f reffile    Use reffile as cross-ref file name instead of %s.\n",
 		REFFILE);
 	fprintf(stderr, "\
+-G depth      Find callers/callees up to depth levels away (0: no limit;\n\
+              needs a -q database).\n\
 -h            This help screen.\n\
 -I incdir     Look in incdir for any #include files.\n\
--i namefile   Browse through files listed in namefile, instead of %s\n",
+-i namefile   Browse through files listed in namefile, instead of %s\n\
+-j n          Build and search with n threads (default: one for each\n\
+              processor available).\n",
 		NAMEFILE);
 	fprintf(stderr, "\
 -k            Kernel Mode - don't use %s for #include files.\n",
@@ -1072,7 +1163,9 @@ longusage(void)
 	fputs("\
 -L            Do a single search with line-oriented output.\n\
 -l            Line-oriented interface.\n\
--num pattern  Go to input field num (counting from 0) and find pattern.\n\
+-num pattern  Go to input field num (counting from 0) and find pattern;\n\
+              -10 finds any of the strings in pattern, separated by |,\n\
+              or listed one to a line in the file named after an @.\n\
 -P path       Prepend path to relative file names in pre-built cross-ref file.\n\
 -p n          Display the last n file path components.\n\
 -q            Build an inverted index for quick symbol searching.\n\
@@ -1102,6 +1195,7 @@ myexit(int sig)
 	if (temp1[0] != '\0') {
 		unlink(temp1);
 		unlink(temp2);
+		postclose(YES);
 		rmdir(tempdirpv);		
 	}
 	/* restore the terminal to its original mode */
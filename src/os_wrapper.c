@@ -1,24 +1,96 @@
+#ifndef _WIN32
+#define _GNU_SOURCE	/* for O_DIRECT */
+#endif
 #include "os_wrapper.h"
 
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
 #include <fcntl.h>
-#ifdef _WIN32
-#include <windows.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
 #include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
 #endif // #ifdef _WIN32
 
+#ifndef _WIN32
+/* the processors a cgroup CPU quota allows, or 0 if there is none; only
+   the cgroup the process sees as its root is looked at, which is the one
+   a container is limited by */
+static int os_get_cpu_quota( void )
+{
+	FILE* f;
+	long quota = -1, period = 0;
+	char max[16];
+
+	/* cgroup v2: "quota period", or "max period" for no limit */
+	if ( ( f = fopen( "/sys/fs/cgroup/cpu.max", "r" ) ) != NULL ) {
+		if ( fscanf( f, "%15s %ld", max, &period ) == 2 &&
+		     strcmp( max, "max" ) != 0 ) {
+			quota = atol( max );
+		}
+		fclose( f );
+	}
+	/* cgroup v1: the quota is -1 for no limit */
+	else if ( ( f = fopen( "/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r" ) ) != NULL ) {
+		if ( fscanf( f, "%ld", &quota ) != 1 ) quota = -1;
+		fclose( f );
+		if ( ( f = fopen( "/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r" ) ) != NULL ) {
+			if ( fscanf( f, "%ld", &period ) != 1 ) period = 0;
+			fclose( f );
+		}
+	}
+	if ( quota <= 0 || period <= 0 ) return 0;
+	return (int)( ( quota + period - 1 ) / period );
+}
+#endif
+
+/* the processors this process may run on, as limited by its affinity mask
+   and any CPU quota */
 int os_get_cpu_core_count( void )
 {
+	int count = 0;
 #ifdef _WIN32
+	DWORD_PTR process_mask, system_mask;
 	SYSTEM_INFO si;
-	GetSystemInfo(&si);
-	int core_num = si.dwNumberOfProcessors;
-	return core_num;
+
+	if ( GetProcessAffinityMask( GetCurrentProcess(), &process_mask, &system_mask ) ) {
+		for ( ; process_mask != 0; process_mask &= process_mask - 1 ) {
+			++count;
+		}
+	}
+	if ( count == 0 ) {
+		GetSystemInfo( &si );
+		count = si.dwNumberOfProcessors;
+	}
 #else
-	return 4;
-#endif
+	int quota;
+#if defined(__linux__) && defined(CPU_COUNT)
+	cpu_set_t set;
 
+	if ( sched_getaffinity( 0, sizeof( set ), &set ) == 0 ) {
+		count = CPU_COUNT( &set );
+	}
+#endif
+#ifdef _SC_NPROCESSORS_ONLN
+	if ( count <= 0 ) {
+		count = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	}
+#endif
+	quota = os_get_cpu_quota();
+	if ( quota > 0 && ( count <= 0 || quota < count ) ) {
+		count = quota;
+	}
+#endif
+	return ( count > 0 ) ? count : 1;
 }
 
 
@@ -36,6 +108,9 @@ int os_mmap( const char* file_path, mmap_info_t* out_info )
 #else
     fd = open(file_path, O_RDONLY);
 #endif
+	out_info->file_handle = -1;
+	out_info->buffer      = NULL;
+	out_info->size        = 0;
 	if ( fd < 0 ) return -1;
 	if ( fstat( fd, &statbuf ) != 0 ) {
 		if ( fd != -1 ) close( fd );
@@ -43,14 +118,14 @@ int os_mmap( const char* file_path, mmap_info_t* out_info )
 	}
 
 	len = (int)statbuf.st_size;
-	if ( out_info->size == 0 ) {
+	if ( len == 0 ) {
 		if ( fd != -1 ) close( fd );
 		return 1;
 	}
 #ifdef _WIN32
     {
         HANDLE hmmap = CreateFileMapping( (HANDLE)_get_osfhandle(fd), 0, PAGE_READONLY, 0, len, NULL);
-        buf = (char *)MapViewOfFile(hmmap, FILE_SHARE_READ, 0, 0, len);
+        buf = (char *)MapViewOfFile(hmmap, FILE_MAP_READ, 0, 0, len);
         if (hmmap != NULL) CloseHandle(hmmap);
     }
     if (buf == NULL) {
@@ -85,3 +160,222 @@ void os_munmap( mmap_info_t* info )
 		close( info->file_handle );
 	}
 }
+
+/* tell the system a mapping will be read from its start to its end, so it
+   reads ahead and drops the pages read */
+void os_madvise_sequential( mmap_info_t* info )
+{
+#if !defined(_WIN32) && defined(POSIX_MADV_SEQUENTIAL)
+	if ( info->buffer != NULL ) {
+		posix_madvise( info->buffer, info->size, POSIX_MADV_SEQUENTIAL );
+	}
+#else
+	(void)info;
+#endif
+}
+
+/* the size of a file, or -1 if it cannot be found */
+long long os_file_size( const char* file_path )
+{
+#ifdef _WIN32
+	struct _stati64 statbuf;
+
+	if ( _stati64( file_path, &statbuf ) != 0 ) return -1;
+#else
+	struct stat statbuf;
+
+	if ( stat( file_path, &statbuf ) != 0 ) return -1;
+#endif
+	return (long long)statbuf.st_size;
+}
+
+/* open a file to read it as it is, without newline translation */
+int os_open_read( const char* file_path )
+{
+#ifdef _WIN32
+	return _open( file_path, _O_RDONLY | _O_BINARY );
+#else
+	return open( file_path, O_RDONLY );
+#endif
+}
+
+/* read up to size bytes from an offset in a file, fewer only at its end;
+   returns the bytes read, or -1 on an error */
+long os_pread( int fd, char* buffer, long size, long long offset )
+{
+	long done, n;
+
+#ifdef _WIN32
+	if ( _lseeki64( fd, offset, SEEK_SET ) < 0 ) return -1;
+#endif
+	for ( done = 0; done < size; done += n ) {
+#ifdef _WIN32
+		n = _read( fd, buffer + done, size - done );
+#else
+		n = pread( fd, buffer + done, size - done, offset + done );
+		if ( n < 0 && errno == EINTR ) {
+			n = 0;
+			continue;
+		}
+#endif
+		if ( n < 0 ) return -1;
+		if ( n == 0 ) break;
+	}
+	return done;
+}
+
+void os_close( int fd )
+{
+#ifdef _WIN32
+	_close( fd );
+#else
+	close( fd );
+#endif
+}
+
+/* a time in seconds, from some fixed point, for measuring how long things
+   take */
+double os_get_time( void )
+{
+#ifdef _WIN32
+	LARGE_INTEGER count, frequency;
+
+	QueryPerformanceCounter( &count );
+	QueryPerformanceFrequency( &frequency );
+	return (double)count.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+int os_truncate( int fd, long size )
+{
+#ifdef _WIN32
+	return _chsize( fd, size );
+#else
+	return ftruncate( fd, size );
+#endif
+}
+
+int os_sync( int fd )
+{
+#ifdef _WIN32
+	return _commit( fd );
+#else
+	return fsync( fd );
+#endif
+}
+
+/* take an exclusive advisory lock on the file, creating it if needed;
+   returns the handle to unlock it with, -1 if another process holds it,
+   or -2 if it cannot be locked at all */
+int os_lock_file( const char* file_path )
+{
+	int fd;
+#ifdef _WIN32
+	OVERLAPPED ov = { 0 };
+
+	fd = _open( file_path, _O_RDWR | _O_CREAT, _S_IREAD | _S_IWRITE );
+	if ( fd < 0 ) return -2;
+	if ( !LockFileEx( (HANDLE)_get_osfhandle( fd ),
+			  LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY,
+			  0, 1, 0, &ov ) ) {
+		int busy = ( GetLastError() == ERROR_LOCK_VIOLATION );
+		_close( fd );
+		return busy ? -1 : -2;
+	}
+#else
+	struct flock fl;
+
+	fd = open( file_path, O_RDWR | O_CREAT, 0666 );
+	if ( fd < 0 ) return -2;
+	fl.l_type   = F_WRLCK;
+	fl.l_whence = SEEK_SET;
+	fl.l_start  = 0;
+	fl.l_len    = 0;
+	if ( fcntl( fd, F_SETLK, &fl ) == -1 ) {
+		int busy = ( errno == EACCES || errno == EAGAIN );
+		close( fd );
+		return busy ? -1 : -2;
+	}
+#endif
+	return fd;
+}
+
+/* release a lock taken by os_lock_file */
+void os_unlock_file( int fd )
+{
+	/* closing the file releases the lock */
+	if ( fd >= 0 ) {
+		close( fd );
+	}
+}
+
+/* open an existing file for writing around the system cache, for large
+   writes aligned to the disk sectors; returns -1 if that is not supported */
+int os_open_direct( const char* file_path )
+{
+#ifdef _WIN32
+	HANDLE h;
+	int fd;
+
+	h = CreateFileA( file_path, GENERIC_WRITE,
+			 FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING,
+			 FILE_FLAG_NO_BUFFERING, NULL );
+	if ( h == INVALID_HANDLE_VALUE ) return -1;
+	fd = _open_osfhandle( (intptr_t)h, 0 );
+	if ( fd < 0 ) CloseHandle( h );
+	return fd;
+#elif defined(O_DIRECT)
+	return open( file_path, O_WRONLY | O_DIRECT );
+#else
+	return -1;
+#endif
+}
+
+/* write the buffers in order at the file position, changing the vector;
+   returns 0, or -1 if they could not all be written */
+int os_writev( int fd, os_iovec_t* iov, int count )
+{
+	long done;
+	int i;
+#ifdef _WIN32
+	for ( i = 0; i < count; ++i ) {
+		for ( done = 0; done < iov[i].size; ) {
+			int n = _write( fd, iov[i].buffer + done, iov[i].size - done );
+			if ( n <= 0 ) return -1;
+			done += n;
+		}
+	}
+#else
+	struct iovec v[16];
+	int n;
+
+	while ( count > 0 ) {
+		n = ( count < 16 ) ? count : 16;
+		for ( i = 0; i < n; ++i ) {
+			v[i].iov_base = iov[i].buffer;
+			v[i].iov_len  = iov[i].size;
+		}
+		done = writev( fd, v, n );
+		if ( done < 0 ) {
+			if ( errno == EINTR ) continue;
+			return -1;
+		}
+		/* skip what was written, which may end inside a buffer */
+		while ( count > 0 && done >= iov->size ) {
+			done -= iov->size;
+			++iov;
+			--count;
+		}
+		if ( count > 0 ) {
+			iov->buffer += done;
+			iov->size -= done;
+		}
+	}
+#endif
+	return 0;
+}
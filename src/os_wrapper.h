@@ -1,3 +1,6 @@
+#ifndef CSCOPE_OS_WRAPPER_H
+#define CSCOPE_OS_WRAPPER_H
+
 
 
 int os_get_cpu_core_count( void );
@@ -10,3 +13,26 @@ typedef struct {
 
 int os_mmap( const char* file_path, mmap_info_t* out_info );
 void os_munmap( mmap_info_t* info );
+void os_madvise_sequential( mmap_info_t* info );
+
+long long os_file_size( const char* file_path );
+int os_open_read( const char* file_path );
+long os_pread( int fd, char* buffer, long size, long long offset );
+void os_close( int fd );
+double os_get_time( void );
+
+int os_truncate( int fd, long size );
+int os_sync( int fd );
+
+int os_lock_file( const char* file_path );
+void os_unlock_file( int fd );
+
+typedef struct {
+	char* buffer;
+	long  size;
+} os_iovec_t;
+
+int os_open_direct( const char* file_path );
+int os_writev( int fd, os_iovec_t* iov, int count );
+
+#endif /* CSCOPE_OS_WRAPPER_H */
@@ -0,0 +1,293 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	source file path trie
+ *
+ *	Each path is stored as its chain of '/' separated components, so a
+ *	directory shared by many files is stored once.  A node knows its
+ *	directory, which gives the path of a file in time proportional to
+ *	its depth, and the range of file indexes below it, which is the
+ *	contiguous list of the files in a directory when the file list is
+ *	sorted by name.  Nodes are found by a hash on the directory node
+ *	and the component name.
+ */
+
+#include "global.h"
+
+#include "alloc.h"
+#include "pathtrie.h"
+
+#define	HASHINIT	4096	/* initial hash table size */
+#define	NODEINC		4096	/* node list size increment */
+#define	STRINC		65536	/* string space size increment */
+
+static	long	ptlookup(PATHTRIE *pt, long parent, char *s, int len,
+			 BOOL insert);
+static	unsigned long pthash(long parent, char *s, int len);
+static	void	ptrehash(PATHTRIE *pt);
+static	void	ptwiden(PATHTRIE *pt, long node, long file);
+
+/* add a file path, and return its node */
+
+long
+ptadd(PATHTRIE *pt, char *path, long file)
+{
+	char	*s;
+	long	node = -1;
+
+	for (;;) {
+		if ((s = strchr(path, '/')) == NULL) {
+			s = path + strlen(path);
+		}
+		node = ptlookup(pt, node, path, s - path, YES);
+		if (*s == '\0') {
+			break;
+		}
+		path = s + 1;
+	}
+	if (pt->nodes[node].file < 0) {
+		pt->nodes[node].file = file;
+		ptwiden(pt, node, file);
+	}
+	return(node);
+}
+
+/* find the node of a file or directory path, or return -1 */
+
+long
+ptfind(PATHTRIE *pt, char *path)
+{
+	char	*s;
+	long	node = -1;
+
+	if (pt->nnodes == 0) {
+		return(-1);
+	}
+	for (;;) {
+		if ((s = strchr(path, '/')) == NULL) {
+			s = path + strlen(path);
+		}
+		if ((node = ptlookup(pt, node, path, s - path, NO)) < 0 ||
+		    *s == '\0') {
+			return(node);
+		}
+		path = s + 1;
+	}
+}
+
+/* put the path of a node into the buffer, or return NULL if it doesn't
+   fit */
+
+char *
+ptpath(PATHTRIE *pt, long node, char *buf, int size)
+{
+	char	*s;
+	long	n;
+	int	len;
+
+	/* the path length, with a separator or the null after each
+	   component */
+	len = 0;
+	for (n = node; n >= 0; n = pt->nodes[n].parent) {
+		len += strlen(pt->strings + pt->nodes[n].name) + 1;
+	}
+	if (len > size) {
+		return(NULL);
+	}
+	/* fill it in from the end */
+	s = buf + len - 1;
+	*s = '\0';
+	for (n = node; n >= 0; n = pt->nodes[n].parent) {
+		len = strlen(pt->strings + pt->nodes[n].name);
+		s -= len;
+		memcpy(s, pt->strings + pt->nodes[n].name, len);
+		if (s > buf) {
+			*--s = '/';
+		}
+	}
+	return(buf);
+}
+
+/* get the range of the indexes of the files in a directory, which are all
+   the files in the range if the file list is sorted; returns 0 if there
+   are none */
+
+int
+ptrange(PATHTRIE *pt, char *dir, long *first, long *last)
+{
+	char	name[PATHLEN + 1];
+	char	*s;
+	long	n;
+
+	/* ignore any trailing separator */
+	snprintf(name, sizeof(name), "%s", dir);
+	s = name + strlen(name);
+	while (s > name + 1 && s[-1] == '/') {
+		*--s = '\0';
+	}
+	*first = *last = -1;
+	if (*name == '\0') {		/* all files */
+		for (n = 0; n < pt->nnodes; ++n) {
+			if (pt->nodes[n].parent < 0 && pt->nodes[n].first >= 0) {
+				if (*first < 0 || pt->nodes[n].first < *first) {
+					*first = pt->nodes[n].first;
+				}
+				if (pt->nodes[n].last > *last) {
+					*last = pt->nodes[n].last;
+				}
+			}
+		}
+	} else if ((n = ptfind(pt, name)) >= 0) {
+		*first = pt->nodes[n].first;
+		*last = pt->nodes[n].last;
+	}
+	return(*first >= 0);
+}
+
+/* set the file indexes to those of the file list, after it was sorted */
+
+void
+ptrenumber(PATHTRIE *pt, char **files, long nfiles)
+{
+	PTNODE	*p, *d;
+	long	i, n;
+
+	for (n = 0; n < pt->nnodes; ++n) {
+		p = &pt->nodes[n];
+		p->file = p->first = p->last = -1;
+	}
+	for (i = 0; i < nfiles; ++i) {
+		if ((n = ptfind(pt, files[i])) >= 0 && pt->nodes[n].file < 0) {
+			p = &pt->nodes[n];
+			p->file = p->first = p->last = i;
+		}
+	}
+	/* a node is after its directory, so going backwards has each
+	   node's range complete before it is added to its directory's */
+	for (n = pt->nnodes - 1; n >= 0; --n) {
+		p = &pt->nodes[n];
+		if (p->parent >= 0 && p->first >= 0) {
+			d = &pt->nodes[p->parent];
+			if (d->first < 0 || p->first < d->first) {
+				d->first = p->first;
+			}
+			if (p->last > d->last) {
+				d->last = p->last;
+			}
+		}
+	}
+}
+
+void
+ptfree(PATHTRIE *pt)
+{
+	free(pt->nodes);
+	free(pt->strings);
+	free(pt->hashtab);
+	pt->nodes = NULL;
+	pt->strings = NULL;
+	pt->hashtab = NULL;
+	pt->nnodes = pt->mnodes = 0;
+	pt->nstrings = pt->mstrings = 0;
+	pt->hashsize = 0;
+}
+
+/* find the node of a component in a directory, adding it if requested */
+
+static long
+ptlookup(PATHTRIE *pt, long parent, char *s, int len, BOOL insert)
+{
+	unsigned long h;
+	long	n;
+	PTNODE	*p;
+	char	*name;
+
+	if (pt->nnodes >= pt->hashsize / 2) {
+		ptrehash(pt);
+	}
+	h = pthash(parent, s, len) & (pt->hashsize - 1);
+	while ((n = pt->hashtab[h]) != -1) {
+		p = &pt->nodes[n];
+		name = pt->strings + p->name;
+		if (p->parent == parent && strncmp(name, s, len) == 0 &&
+		    name[len] == '\0') {
+			return(n);
+		}
+		h = (h + 1) & (pt->hashsize - 1);
+	}
+	if (insert == NO) {
+		return(-1);
+	}
+	/* add the component */
+	if (pt->nnodes == pt->mnodes) {
+		pt->mnodes += NODEINC;
+		pt->nodes = myrealloc(pt->nodes, pt->mnodes * sizeof(PTNODE));
+	}
+	if (pt->nstrings + len + 1 > pt->mstrings) {
+		pt->mstrings += (len + 1 > STRINC) ? len + 1 : STRINC;
+		pt->strings = myrealloc(pt->strings, pt->mstrings);
+	}
+	memcpy(pt->strings + pt->nstrings, s, len);
+	pt->strings[pt->nstrings + len] = '\0';
+	p = &pt->nodes[pt->nnodes];
+	p->name = pt->nstrings;
+	p->parent = parent;
+	p->file = p->first = p->last = -1;
+	pt->nstrings += len + 1;
+	pt->hashtab[h] = pt->nnodes;
+	return(pt->nnodes++);
+}
+
+/* grow the hash table when it is half full */
+
+static void
+ptrehash(PATHTRIE *pt)
+{
+	unsigned long h;
+	long	i, n;
+	PTNODE	*p;
+
+	free(pt->hashtab);
+	pt->hashsize = (pt->hashsize == 0) ? HASHINIT : pt->hashsize * 2;
+	pt->hashtab = mymalloc(pt->hashsize * sizeof(int));
+	for (i = 0; i < pt->hashsize; ++i) {
+		pt->hashtab[i] = -1;
+	}
+	for (n = 0; n < pt->nnodes; ++n) {
+		p = &pt->nodes[n];
+		h = pthash(p->parent, pt->strings + p->name,
+			   strlen(pt->strings + p->name)) & (pt->hashsize - 1);
+		while (pt->hashtab[h] != -1) {
+			h = (h + 1) & (pt->hashsize - 1);
+		}
+		pt->hashtab[h] = n;
+	}
+}
+
+static unsigned long
+pthash(long parent, char *s, int len)
+{
+	unsigned long h = 5381 + parent;
+
+	while (len-- > 0) {
+		h = h * 33 + (unsigned char) *s++;
+	}
+	return(h);
+}
+
+/* add a file index to the range of a node and its directories */
+
+static void
+ptwiden(PATHTRIE *pt, long node, long file)
+{
+	PTNODE	*p;
+
+	for (; node >= 0; node = p->parent) {
+		p = &pt->nodes[node];
+		if (p->first < 0 || file < p->first) {
+			p->first = file;
+		}
+		if (file > p->last) {
+			p->last = file;
+		}
+	}
+}
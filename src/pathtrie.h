@@ -0,0 +1,34 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	source file path trie definitions
+ */
+
+#ifndef CSCOPE_PATHTRIE_H
+#define CSCOPE_PATHTRIE_H
+
+/* ints rather than longs keep the nodes small on 64-bit hosts */
+typedef	struct {
+	int	name;		/* component offset in the string space */
+	int	parent;		/* directory node, or -1 at the top */
+	int	file;		/* source file index, or -1 if not a file */
+	int	first;		/* lowest file index below this node */
+	int	last;		/* highest file index below this node */
+} PTNODE;
+
+typedef	struct {
+	PTNODE	*nodes;		/* nodes, each after its directory */
+	long	nnodes, mnodes;
+	char	*strings;	/* component string space */
+	long	nstrings, mstrings;
+	int	*hashtab;	/* nodes by directory and component */
+	long	hashsize;
+} PATHTRIE;
+
+long	ptadd(PATHTRIE *pt, char *path, long file);
+long	ptfind(PATHTRIE *pt, char *path);
+void	ptfree(PATHTRIE *pt);
+char	*ptpath(PATHTRIE *pt, long node, char *buf, int size);
+int	ptrange(PATHTRIE *pt, char *dir, long *first, long *last);
+void	ptrenumber(PATHTRIE *pt, char **files, long nfiles);
+
+#endif /* CSCOPE_PATHTRIE_H */
@@ -0,0 +1,300 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	worker thread pool
+ *
+ *	The pool is started when it is first used and its threads last as
+ *	long as the process, so a search or a build does not start threads of
+ *	its own.  There is a worker for each processor but the submitting
+ *	one's, thread_worker_count in all, which the -j option sets.
+ *
+ *	Each worker has a deque of tasks.  The tasks a worker submits go on
+ *	the bottom of its own deque, and it takes the newest of them first,
+ *	while its data is still in the cache.  Tasks submitted by other
+ *	threads go on a shared queue, which is taken in order.  A worker with
+ *	nothing of its own to do takes from the shared queue, and then steals
+ *	the oldest task from the top of another worker's deque.  A thread
+ *	waiting for a group of tasks runs tasks too, so a pool with no
+ *	workers runs them in the submitting thread.
+ */
+
+#include "global.h"
+
+#include "alloc.h"
+#include "pool.h"
+
+#include <pthread.h>
+
+#define	DEQUEINIT	64	/* initial deque size, a power of two */
+
+typedef	struct {
+	POOLTASK task;
+	void	*arg;
+	POOLGROUP *group;
+} TASK;
+
+typedef	struct {
+	TASK	*tasks;		/* ring of tasks */
+	long	size;		/* its size, a power of two */
+	long	top;		/* the oldest task */
+	long	bottom;		/* past the newest one */
+	pthread_mutex_t lock;
+} DEQUE;
+
+static	DEQUE	*deques;	/* a deque for each worker */
+static	DEQUE	shared;		/* tasks from other threads */
+static	pthread_t workers[MAXPOOL];
+static	int	nworkers;
+static	long	queued;		/* tasks in the deques */
+static	int	idle;		/* workers waiting for a task */
+static	int	waiting;	/* threads waiting for a group */
+static	pthread_key_t self;	/* a worker's own deque */
+static	pthread_once_t once = PTHREAD_ONCE_INIT;
+static	pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static	pthread_cond_t work = PTHREAD_COND_INITIALIZER;	/* a task queued */
+static	pthread_cond_t done = PTHREAD_COND_INITIALIZER;	/* a group is done */
+
+static	void	dequeinit(DEQUE *d);
+static	void	push(DEQUE *d, TASK *t);
+static	BOOL	popbottom(DEQUE *d, TASK *t);
+static	BOOL	poptop(DEQUE *d, TASK *t);
+static	void	poolstart(void);
+static	void	*poolthread(void *arg);
+static	void	run(TASK *t);
+static	BOOL	take(DEQUE *own, TASK *t);
+
+/* return the number of worker threads, which may be 0 */
+
+int
+poolsize(void)
+{
+	pthread_once(&once, poolstart);
+	return(nworkers);
+}
+
+/* run the task with the argument on a worker */
+
+void
+poolsubmit(POOLGROUP *group, POOLTASK task, void *arg)
+{
+	DEQUE	*own;
+	TASK	t;
+
+	pthread_once(&once, poolstart);
+	if (nworkers == 0) {
+		(*task)(arg);
+		return;
+	}
+	t.task = task;
+	t.arg = arg;
+	t.group = group;
+	pthread_mutex_lock(&lock);
+	++group->pending;
+	pthread_mutex_unlock(&lock);
+
+	if ((own = pthread_getspecific(self)) != NULL) {
+		push(own, &t);
+	} else {
+		push(&shared, &t);
+	}
+	pthread_mutex_lock(&lock);
+	++queued;
+	if (idle > 0) {
+		pthread_cond_signal(&work);
+	}
+	if (waiting > 0) {
+		pthread_cond_broadcast(&done);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+/* wait for the group's tasks to be done, running tasks meanwhile */
+
+void
+poolwait(POOLGROUP *group)
+{
+	DEQUE	*own;
+	TASK	t;
+
+	if (nworkers == 0) {
+		return;
+	}
+	own = pthread_getspecific(self);
+	for (;;) {
+		pthread_mutex_lock(&lock);
+		if (group->pending == 0) {
+			pthread_mutex_unlock(&lock);
+			return;
+		}
+		pthread_mutex_unlock(&lock);
+		if (take(own, &t) == YES) {
+			run(&t);
+			continue;
+		}
+		pthread_mutex_lock(&lock);
+		while (group->pending > 0 && queued == 0) {
+			++waiting;
+			pthread_cond_wait(&done, &lock);
+			--waiting;
+		}
+		pthread_mutex_unlock(&lock);
+	}
+}
+
+/* start a worker for each processor but this one */
+
+static void
+poolstart(void)
+{
+	int	i, n;
+
+	n = thread_worker_count - 1;
+	if (n > MAXPOOL) {
+		n = MAXPOOL;
+	}
+	if (n <= 0 || pthread_key_create(&self, NULL) != 0) {
+		return;
+	}
+	dequeinit(&shared);
+	deques = mycalloc(n, sizeof(DEQUE));
+	for (i = 0; i < n; ++i) {
+		dequeinit(&deques[i]);
+	}
+	/* the workers wait for the lock, so they see the final count */
+	pthread_mutex_lock(&lock);
+	for (nworkers = 0; nworkers < n; ++nworkers) {
+		if (pthread_create(&workers[nworkers], NULL, poolthread,
+				   &deques[nworkers]) != 0) {
+			break;
+		}
+		pthread_detach(workers[nworkers]);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+static void *
+poolthread(void *arg)
+{
+	DEQUE	*own = arg;
+	TASK	t;
+
+	pthread_setspecific(self, own);
+	pthread_mutex_lock(&lock);
+	pthread_mutex_unlock(&lock);
+	for (;;) {
+		if (take(own, &t) == YES) {
+			run(&t);
+			continue;
+		}
+		pthread_mutex_lock(&lock);
+		while (queued == 0) {
+			++idle;
+			pthread_cond_wait(&work, &lock);
+			--idle;
+		}
+		pthread_mutex_unlock(&lock);
+	}
+	/* NOTREACHED */
+	return(NULL);
+}
+
+/* run a task, and tell any waiters when its group is done */
+
+static void
+run(TASK *t)
+{
+	(*t->task)(t->arg);
+	pthread_mutex_lock(&lock);
+	if (--t->group->pending == 0 && waiting > 0) {
+		pthread_cond_broadcast(&done);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+/* take a task: the newest of the thread's own, the oldest submitted by
+   other threads, or the oldest of another worker's */
+
+static BOOL
+take(DEQUE *own, TASK *t)
+{
+	int	i, start;
+
+	if (own != NULL && popbottom(own, t) == YES) {
+		goto found;
+	}
+	if (poptop(&shared, t) == YES) {
+		goto found;
+	}
+	start = (own != NULL) ? own - deques + 1 : 0;
+	for (i = 0; i < nworkers; ++i) {
+		DEQUE	*d = &deques[(start + i) % nworkers];
+
+		if (d != own && poptop(d, t) == YES) {
+			goto found;
+		}
+	}
+	return(NO);
+found:
+	pthread_mutex_lock(&lock);
+	--queued;
+	pthread_mutex_unlock(&lock);
+	return(YES);
+}
+
+static void
+dequeinit(DEQUE *d)
+{
+	d->size = DEQUEINIT;
+	d->tasks = mymalloc(d->size * sizeof(TASK));
+	d->top = d->bottom = 0;
+	pthread_mutex_init(&d->lock, NULL);
+}
+
+/* put a task on the bottom of a deque, growing it if it is full */
+
+static void
+push(DEQUE *d, TASK *t)
+{
+	TASK	*tasks;
+	long	i;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->bottom - d->top == d->size) {
+		tasks = mymalloc(2 * d->size * sizeof(TASK));
+		for (i = d->top; i < d->bottom; ++i) {
+			tasks[i & (2 * d->size - 1)] = d->tasks[i & (d->size - 1)];
+		}
+		free(d->tasks);
+		d->tasks = tasks;
+		d->size *= 2;
+	}
+	d->tasks[d->bottom++ & (d->size - 1)] = *t;
+	pthread_mutex_unlock(&d->lock);
+}
+
+static BOOL
+popbottom(DEQUE *d, TASK *t)
+{
+	BOOL	found = NO;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->bottom > d->top) {
+		*t = d->tasks[--d->bottom & (d->size - 1)];
+		found = YES;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return(found);
+}
+
+static BOOL
+poptop(DEQUE *d, TASK *t)
+{
+	BOOL	found = NO;
+
+	pthread_mutex_lock(&d->lock);
+	if (d->bottom > d->top) {
+		*t = d->tasks[d->top++ & (d->size - 1)];
+		found = YES;
+	}
+	pthread_mutex_unlock(&d->lock);
+	return(found);
+}
@@ -0,0 +1,24 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	worker thread pool definitions
+ */
+
+#ifndef CSCOPE_POOL_H
+#define CSCOPE_POOL_H
+
+#include "global.h"
+
+#define	MAXPOOL		64	/* most worker threads */
+
+typedef	void	(*POOLTASK)(void *arg);
+
+/* tasks waited for together */
+typedef	struct {
+	long	pending;	/* submitted and not yet done */
+} POOLGROUP;
+
+int	poolsize(void);
+void	poolsubmit(POOLGROUP *group, POOLTASK task, void *arg);
+void	poolwait(POOLGROUP *group);
+
+#endif /* CSCOPE_POOL_H */
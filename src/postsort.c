@@ -0,0 +1,477 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	inverted index postings sort
+ *
+ *	The postings are collected in a memory buffer while the source files
+ *	are cross-referenced.  When it is full, it is given to the worker
+ *	pool, which sorts the full buffers and writes them to run files
+ *	while another buffer is filled, so the sort overlaps the
+ *	scanning instead of following it.  The buffers share a memory budget
+ *	of CSCOPE_SORTMEM megabytes.  At the end, the last buffer is sorted
+ *	in memory and merged with the runs straight into invmakefrom(), so
+ *	the sorted postings are never written.  Only MERGEWIDTH runs are open
+ *	at once, so if there are more, groups of them are first merged into
+ *	longer runs until the rest can all be open.  The lines are compared as
+ *	unsigned bytes, which is the order of LC_ALL=C sort, whatever the
+ *	locale.
+ *
+ *	The runs are named by a prefix and their number.  They can be synced
+ *	to disk, so a checkpoint of the build can refer to them.
+ */
+
+#include "global.h"
+
+#include "alloc.h"
+#include "invlib.h"
+#include "library.h"
+#include "os_wrapper.h"
+#include "pool.h"
+#include "postsort.h"
+
+#include <sys/stat.h>
+#include <limits.h>
+#include <pthread.h>
+
+#define	LINEMAX		512	/* posting line max size, as in invmake() */
+#define	LINESINC	65536	/* line list size increment */
+#define	MINBUFSIZE	(1024 * 1024)	/* smallest buffer */
+
+typedef	struct runbuf {
+	char	*text;		/* posting lines, each null terminated */
+	long	used;		/* bytes of text used */
+	char	**lines;	/* the lines, in sorted order after sorting */
+	long	nlines, mlines;
+	int	run;		/* run number when full */
+	struct	runbuf *next;	/* next empty buffer */
+} RUNBUF;
+
+typedef	struct {
+	FILE	*file;		/* run file, or NULL for the last buffer */
+	char	**next;		/* next line of the last buffer */
+	char	**end;		/* end of its lines */
+	char	*line;		/* current line */
+	char	buf[LINEMAX];	/* current run file line */
+} SOURCE;
+
+static	RUNBUF	*bufs;		/* a buffer for each sorter, and one more */
+static	int	nbufs;
+static	long	bufsize;	/* memory for each buffer */
+static	RUNBUF	*filling;	/* buffer being filled */
+static	RUNBUF	*empty;		/* empty buffers */
+static	POOLGROUP sorting;	/* buffers being sorted */
+static	int	nruns;		/* runs written or being written */
+static	char	*runprefix;	/* run file name prefix */
+static	BOOL	durable;	/* sync the runs to disk */
+static	BOOL	failed;		/* a run could not be written */
+static	pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static	pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+static	SOURCE	*sources;	/* merge sources */
+static	int	nsources;
+static	int	*heap;		/* sources by current line */
+static	int	nheap;
+
+static	void	handoff(void);
+static	int	linecompare(const void *l1, const void *l2);
+static	void	mergeclose(void);
+static	char	*mergeline(char *line, int size, void *arg);
+static	BOOL	mergeopen(int first, int n, BOOL last);
+static	BOOL	mergerun(int first);
+static	BOOL	nextsource(int i);
+static	BOOL	putrun(RUNBUF *b, int run);
+static	void	runname(int run, char *path, int size);
+static	void	siftdown(int k);
+static	void	sorttask(void *arg);
+
+/* start collecting postings, with the runs named by the prefix */
+
+void
+postopen(char *prefix, BOOL sync)
+{
+	long	budget;
+	int	i, n;
+
+	runprefix = prefix;
+	durable = sync;
+	nruns = 0;
+	failed = NO;
+
+	/* a buffer for each pool worker to sort */
+	n = poolsize();
+	if (n < 1) {
+		n = 1;
+	} else if (n > MAXSORTERS) {
+		n = MAXSORTERS;
+	}
+	budget = atol(mygetenv("CSCOPE_SORTMEM", ""));
+	if (budget <= 0) {
+		budget = SORTMEM;
+	} else if (budget > LONG_MAX / (1024 * 1024)) {	/* 32-bit long */
+		budget = LONG_MAX / (1024 * 1024);
+	}
+	nbufs = n + 1;
+	bufsize = budget * 1024 * 1024 / nbufs;
+	if (bufsize < MINBUFSIZE) {
+		bufsize = MINBUFSIZE;
+	}
+	bufs = mycalloc(nbufs, sizeof(RUNBUF));
+	for (i = 0; i < nbufs; ++i) {
+		bufs[i].text = mymalloc(bufsize);
+		bufs[i].next = (i + 1 < nbufs) ? &bufs[i + 1] : NULL;
+	}
+	filling = &bufs[0];
+	empty = &bufs[1];
+}
+
+/* add a posting line, without its newline */
+
+void
+postput(char *line, int len)
+{
+	RUNBUF	*b = filling;
+
+	/* the line list is part of the budget */
+	if (b->used + len + 1 + (b->nlines + 1) * (long) sizeof(char *) >
+	    bufsize) {
+		handoff();
+		b = filling;
+	}
+	if (b->nlines == b->mlines) {
+		b->mlines += LINESINC;
+		b->lines = myrealloc(b->lines, b->mlines * sizeof(char *));
+	}
+	b->lines[b->nlines++] = memcpy(b->text + b->used, line, len);
+	b->text[b->used + len] = '\0';
+	b->used += len + 1;
+}
+
+/* put all the postings so far into runs, and return the number of runs, or
+   -1 if they could not all be written */
+
+int
+postsync(void)
+{
+	handoff();
+	poolwait(&sorting);
+	return((failed == YES) ? -1 : nruns);
+}
+
+/* continue from the runs put by postsync(); returns NO if they are not all
+   there */
+
+BOOL
+postresume(int runs)
+{
+	char	path[PATHLEN + 1];
+	struct	stat	statstruct;
+
+	for (nruns = 0; nruns < runs; ++nruns) {
+		runname(nruns, path, sizeof(path));
+		if (stat(path, &statstruct) != 0) {
+			nruns = 0;
+			return(NO);
+		}
+	}
+	return(YES);
+}
+
+/* merge the runs and the last buffer into the inverted index, and return
+   the number of terms, or 0 if it could not be made */
+
+long
+postmake(char *invname, char *invpost)
+{
+	long	totalterms = 0;
+	int	first;
+
+	poolwait(&sorting);
+	if (failed == YES) {
+		return(0);
+	}
+	/* merge the oldest runs into new ones until the rest fit */
+	for (first = 0; nruns - first > MERGEWIDTH; first += MERGEWIDTH) {
+		if (mergerun(first) == NO) {
+			failed = YES;
+			return(0);
+		}
+	}
+	qsort(filling->lines, filling->nlines, sizeof(char *), linecompare);
+
+	/* the runs and then the last buffer */
+	if (mergeopen(first, nruns - first, YES) == YES) {
+		totalterms = invmakefrom(invname, invpost, mergeline, NULL);
+	}
+	mergeclose();
+	return(totalterms);
+}
+
+/* stop collecting postings, and remove the runs unless keep is YES and they
+   were synced for a checkpoint */
+
+void
+postclose(BOOL keep)
+{
+	char	path[PATHLEN + 1];
+	int	i;
+
+	poolwait(&sorting);
+	if (keep == NO || durable == NO) {
+		for (i = 0; i < nruns; ++i) {
+			runname(i, path, sizeof(path));
+			unlink(path);
+		}
+	}
+	nruns = 0;
+	for (i = 0; i < nbufs; ++i) {
+		free(bufs[i].text);
+		free(bufs[i].lines);
+	}
+	free(bufs);
+	bufs = filling = empty = NULL;
+	nbufs = 0;
+}
+
+/* give the filled buffer to the pool to sort, and fill an empty one */
+
+static void
+handoff(void)
+{
+	if (filling->nlines == 0) {
+		return;
+	}
+	filling->run = nruns++;
+	poolsubmit(&sorting, sorttask, filling);
+
+	/* without pool workers the run was sorted as the buffer filled */
+	pthread_mutex_lock(&lock);
+	while (empty == NULL) {
+		pthread_cond_wait(&cond, &lock);
+	}
+	filling = empty;
+	empty = empty->next;
+	pthread_mutex_unlock(&lock);
+}
+
+/* pool task writing a full buffer to its run and emptying it */
+
+static void
+sorttask(void *arg)
+{
+	RUNBUF	*b = arg;
+	BOOL	ok;
+
+	ok = putrun(b, b->run);
+	pthread_mutex_lock(&lock);
+	if (ok == NO) {
+		failed = YES;
+	}
+	b->next = empty;
+	empty = b;
+	pthread_cond_broadcast(&cond);
+	pthread_mutex_unlock(&lock);
+}
+
+/* sort a buffer, write it to a run file and empty it */
+
+static BOOL
+putrun(RUNBUF *b, int run)
+{
+	char	path[PATHLEN + 1];
+	FILE	*f;
+	long	i;
+	BOOL	ok = NO;
+
+	qsort(b->lines, b->nlines, sizeof(char *), linecompare);
+	runname(run, path, sizeof(path));
+	if ((f = myfopen(path, "wb")) != NULL) {
+		for (i = 0; i < b->nlines; ++i) {
+			(void) fputs(b->lines[i], f);
+			(void) putc('\n', f);
+		}
+		ok = (fflush(f) != EOF &&
+		      (durable == NO || os_sync(fileno(f)) == 0));
+		if (fclose(f) == EOF) {
+			ok = NO;
+		}
+	}
+	b->used = b->nlines = 0;
+	return(ok);
+}
+
+static void
+runname(int run, char *path, int size)
+{
+	snprintf(path, size, "%s.%d", runprefix, run);
+}
+
+/* start merging n runs from the first, and the last buffer if last is
+   YES; returns NO if a run cannot be opened */
+
+static BOOL
+mergeopen(int first, int n, BOOL last)
+{
+	char	path[PATHLEN + 1];
+	BOOL	ok = YES;
+	int	i;
+
+	sources = mymalloc((n + 1) * sizeof(SOURCE));
+	heap = mymalloc((n + 1) * sizeof(int));
+	nsources = n;
+	nheap = 0;
+	for (i = 0; i < n; ++i) {
+		runname(first + i, path, sizeof(path));
+		if ((sources[i].file = myfopen(path, "rb")) == NULL) {
+			ok = NO;
+		} else if (nextsource(i) == YES) {
+			heap[nheap++] = i;
+		}
+	}
+	if (last == YES) {
+		sources[n].file = NULL;
+		sources[n].next = filling->lines;
+		sources[n].end = filling->lines + filling->nlines;
+		if (nextsource(n) == YES) {
+			heap[nheap++] = n;
+		}
+	}
+	for (i = nheap / 2 - 1; i >= 0; --i) {
+		siftdown(i);
+	}
+	return(ok);
+}
+
+/* close the merge sources */
+
+static void
+mergeclose(void)
+{
+	int	i;
+
+	for (i = 0; i < nsources; ++i) {
+		if (sources[i].file != NULL) {
+			fclose(sources[i].file);
+		}
+	}
+	free(sources);
+	free(heap);
+	sources = NULL;
+	heap = NULL;
+	nsources = nheap = 0;
+}
+
+/* merge MERGEWIDTH runs from the first into a new run; returns NO if it
+   could not be written */
+
+static BOOL
+mergerun(int first)
+{
+	char	path[PATHLEN + 1];
+	char	line[LINEMAX + 1];
+	FILE	*f;
+	BOOL	ok = NO;
+	int	i;
+
+	runname(nruns, path, sizeof(path));
+	if (mergeopen(first, MERGEWIDTH, NO) == YES &&
+	    (f = myfopen(path, "wb")) != NULL) {
+		while (mergeline(line, sizeof(line), NULL) != NULL) {
+			(void) fputs(line, f);
+		}
+		ok = (fflush(f) != EOF &&
+		      (durable == NO || os_sync(fileno(f)) == 0));
+		if (fclose(f) == EOF) {
+			ok = NO;
+		}
+	}
+	mergeclose();
+	++nruns;	/* so postclose() removes it */
+
+	/* the runs of a checkpoint are kept until the build is done */
+	if (ok == YES && durable == NO) {
+		for (i = first; i < first + MERGEWIDTH; ++i) {
+			runname(i, path, sizeof(path));
+			unlink(path);
+		}
+	}
+	return(ok);
+}
+
+/* get the next line of a merge source; returns NO at its end */
+
+static BOOL
+nextsource(int i)
+{
+	SOURCE	*s = &sources[i];
+	char	*p;
+
+	if (s->file == NULL) {
+		if (s->next == s->end) {
+			return(NO);
+		}
+		s->line = *s->next++;
+		return(YES);
+	}
+	if (fgets(s->buf, sizeof(s->buf), s->file) == NULL) {
+		return(NO);
+	}
+	if ((p = strchr(s->buf, '\n')) != NULL) {
+		*p = '\0';
+	}
+	s->line = s->buf;
+	return(YES);
+}
+
+/* get the next line of the merge for invmakefrom() */
+
+static char *
+mergeline(char *line, int size, void *arg)
+{
+	int	len;
+
+	if (nheap == 0) {
+		return(NULL);
+	}
+	len = strlen(sources[heap[0]].line);
+	if (len > size - 2) {
+		len = size - 2;
+	}
+	memcpy(line, sources[heap[0]].line, len);
+	line[len] = '\n';
+	line[len + 1] = '\0';
+
+	/* replace the source's line with its next one */
+	if (nextsource(heap[0]) == NO) {
+		heap[0] = heap[--nheap];
+	}
+	siftdown(0);
+	return(line);
+}
+
+/* move a heap entry down to its place */
+
+static void
+siftdown(int k)
+{
+	int	c, t;
+
+	for (; (c = 2 * k + 1) < nheap; k = c) {
+		if (c + 1 < nheap && strcmp(sources[heap[c + 1]].line,
+					    sources[heap[c]].line) < 0) {
+			++c;
+		}
+		if (strcmp(sources[heap[k]].line, sources[heap[c]].line) <= 0) {
+			break;
+		}
+		t = heap[k];
+		heap[k] = heap[c];
+		heap[c] = t;
+	}
+}
+
+/* byte order line comparison function for qsort */
+
+static int
+linecompare(const void *l1, const void *l2)
+{
+	return(strcmp(*(char **) l1, *(char **) l2));
+}
@@ -0,0 +1,22 @@
+/*	cscope - interactive C symbol cross-reference
+ *
+ *	inverted index postings sort definitions
+ */
+
+#ifndef CSCOPE_POSTSORT_H
+#define CSCOPE_POSTSORT_H
+
+#include "global.h"
+
+#define	SORTMEM		64	/* default sort memory in megabytes */
+#define	MAXSORTERS	8	/* most buffers sorted at once */
+#define	MERGEWIDTH	64	/* most runs merged at once */
+
+void	postopen(char *prefix, BOOL sync);
+void	postput(char *line, int len);
+int	postsync(void);
+BOOL	postresume(int runs);
+long	postmake(char *invname, char *invpost);
+void	postclose(BOOL keep);
+
+#endif /* CSCOPE_POSTSORT_H */
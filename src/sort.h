@@ -1 +0,0 @@
-void sort (char * const *files, size_t nfiles, char const *output_file);